@@ -0,0 +1,169 @@
+// Measures LOG_INFO call latency and throughput for several outputs.
+//
+// Usage: logging_benchmark [max threads] [messages per thread] [log file]
+//
+// Log output goes to /dev/null, the given file or a callback, the report
+// itself is written to the original stdout.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_sink.h"
+#include "logging.h"
+#include "sinks.h"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Scenario
+{
+  const char* name;
+  std::function<void()> setup;
+  std::function<void()> teardown;
+  logging::LogLevel level;
+};
+
+struct Stats
+{
+  double p50;
+  double p99;
+  double p999;
+  double max;
+  double messagesPerSecond;
+};
+
+FILE* gReport = stdout;
+
+Stats Run(uint32_t threads, uint32_t messages, logging::LogLevel level)
+{
+  std::vector<std::vector<uint32_t>> latencies(threads, std::vector<uint32_t>(messages));
+  std::vector<std::thread> workers;
+
+  const auto start = Clock::now();
+  for (uint32_t t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([t, messages, level, &latencies]() {
+      auto& samples = latencies[t];
+      for (uint32_t i = 0; i < messages; ++i)
+      {
+        const auto before = Clock::now();
+        if (level == logging::LogLevel::Info)
+          LOG_INFO("Handled request %u on worker %u in %.3f ms: %s", i, t, 1.234, "status ok");
+        else
+          LOG_TRACE("Handled request %u on worker %u in %.3f ms: %s", i, t, 1.234, "status ok");
+        samples[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+      }
+    });
+  }
+
+  for (auto& worker : workers)
+    worker.join();
+
+  // Pending async records are part of the cost
+  logging::Flush();
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<uint32_t> all;
+  all.reserve(static_cast<size_t>(threads) * messages);
+  for (const auto& samples : latencies)
+    all.insert(all.end(), samples.begin(), samples.end());
+  std::sort(all.begin(), all.end());
+
+  auto percentile = [&all](double p) {
+    return static_cast<double>(all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]);
+  };
+
+  return {percentile(0.50), percentile(0.99), percentile(0.999), static_cast<double>(all.back()),
+          all.size() / seconds};
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const uint32_t maxThreads = argc > 1 ? std::max(1, atoi(argv[1])) : std::max(1u, std::thread::hardware_concurrency());
+  const uint32_t messages = argc > 2 ? std::max(1, atoi(argv[2])) : 100000;
+  const std::string logFile = argc > 3 ? argv[3] : "logging_benchmark.log";
+
+  // Keep the real stdout for the report, the console sink writes to /dev/null
+  gReport = fdopen(dup(STDOUT_FILENO), "w");
+  if (!gReport || !freopen("/dev/null", "w", stdout))
+  {
+    fprintf(stderr, "Failed to redirect stdout\n");
+    return 1;
+  }
+
+  std::shared_ptr<logging::FileSink> fileSink;
+
+  std::vector<Scenario> scenarios = {
+      {"console > /dev/null", [] {}, [] {}, logging::LogLevel::Info},
+      {"file sink",
+       [&] {
+         logging::FileSinkOptions options;
+         options.path = logFile;
+         fileSink = std::make_shared<logging::FileSink>(options);
+         fileSink->Open();
+         logging::RemoveSink(logging::CONSOLE_SINK);
+         logging::AddSink(fileSink);
+       },
+       [&] {
+         logging::ClearSinks();
+         logging::AddSink(std::make_shared<logging::ConsoleSink>());
+         fileSink.reset();
+         std::remove(logFile.c_str());
+       },
+       logging::LogLevel::Info},
+      {"gLogToStream only",
+       [] {
+         logging::RemoveSink(logging::CONSOLE_SINK);
+         logging::gLogToStream = [](auto, auto, const std::string& file, auto, const std::string& message) {
+           static std::atomic<size_t> bytes = 0;
+           bytes += file.size() + message.size();
+         };
+       },
+       [] {
+         logging::gLogToStream = nullptr;
+         logging::ClearSinks();
+         logging::AddSink(std::make_shared<logging::ConsoleSink>());
+       },
+       logging::LogLevel::Info},
+      {"filtered out (trace)", [] {}, [] {}, logging::LogLevel::Trace},
+      {"async console > /dev/null", [] { logging::EnableAsync(1 << 16, logging::OverflowPolicy::Block); }, [] { logging::DisableAsync(); }, logging::LogLevel::Info},
+  };
+
+  logging::gMinLogLevel = logging::LogLevel::Info;
+
+  // 1, 2, 4... and always the requested maximum
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+    threadCounts.push_back(threads);
+  threadCounts.push_back(maxThreads);
+
+  fprintf(gReport, "%-28s %8s %10s %10s %10s %12s %14s\n", "scenario", "threads", "p50 ns", "p99 ns", "p999 ns", "max ns", "msgs/s");
+  for (const auto& scenario : scenarios)
+  {
+    scenario.setup();
+    for (uint32_t threads : threadCounts)
+    {
+      Stats stats = Run(threads, messages, scenario.level);
+      fprintf(gReport, "%-28s %8u %10.0f %10.0f %10.0f %12.0f %14.0f\n", scenario.name, threads, stats.p50,
+              stats.p99, stats.p999, stats.max, stats.messagesPerSecond);
+      fflush(gReport);
+    }
+    scenario.teardown();
+  }
+
+  return 0;
+}
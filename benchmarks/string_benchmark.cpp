@@ -0,0 +1,219 @@
+// Measures the string_helpers.h functions on small, medium and multi-megabyte inputs.
+//
+// Usage: string_benchmark [seconds per case] [name filter]
+//
+// Reports ns/op, input bytes/s and heap allocations per op. Allocations are
+// counted by replacing the global operator new.
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_helpers.h"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<uint64_t> gAllocations{0};
+
+// Keeps results alive so the compiler cannot drop the measured calls
+volatile size_t gSink = 0;
+
+struct Corpus
+{
+  const char* name;
+  // Log line like text, ',' separated fields, ';' separated k=v pairs
+  std::string text;
+  // Same text padded with whitespace on both ends
+  std::string padded;
+  // "k1=v1;k2=v2..." of about the same size
+  std::string pairs;
+  std::vector<uint32_t> values;
+};
+
+Corpus MakeCorpus(const char* name, size_t size)
+{
+  static const char* const WORDS[] = {"GET", "/api/v1/items", "200", "OK", "user=alice", "Mozilla/5.0", "gzip",
+                                      "192.168.1.17", "timeout", "retry", "cache-hit", "x86_64", "ERROR", "12.5ms"};
+
+  Corpus corpus;
+  corpus.name = name;
+
+  uint32_t seed = 12345;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+  };
+
+  while (corpus.text.size() < size)
+  {
+    corpus.text += WORDS[next() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+    corpus.text += next() % 8 == 0 ? '\n' : ',';
+  }
+  corpus.text.resize(size);
+
+  corpus.padded = "  \t " + corpus.text + " \r\n ";
+
+  for (uint32_t i = 0; corpus.pairs.size() < size; ++i)
+  {
+    corpus.pairs += "key" + std::to_string(i) + '=' + WORDS[next() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+    corpus.pairs += ';';
+  }
+
+  // One value per ~8 input bytes, so the output has a similar size
+  corpus.values.resize(std::max<size_t>(1, size / 8));
+  for (uint32_t& value : corpus.values)
+    value = next();
+
+  return corpus;
+}
+
+struct Benchmark
+{
+  const char* name;
+  // Input bytes processed by one call, for bytes/s
+  std::function<size_t(const Corpus&)> bytes;
+  std::function<void(const Corpus&)> run;
+};
+
+void Measure(const Benchmark& benchmark, const Corpus& corpus, double seconds)
+{
+  // Warm up caches and the allocator
+  benchmark.run(corpus);
+
+  // Double the batch until it runs long enough to time reliably
+  uint64_t iterations = 1;
+  double elapsed = 0;
+  uint64_t allocations = 0;
+  for (;;)
+  {
+    const uint64_t allocationsBefore = gAllocations.load(std::memory_order_relaxed);
+    const auto start = Clock::now();
+    for (uint64_t i = 0; i < iterations; ++i)
+      benchmark.run(corpus);
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    allocations = gAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+    if (elapsed >= seconds || iterations >= (uint64_t(1) << 40))
+      break;
+    iterations *= elapsed > 0 ? std::max<uint64_t>(2, static_cast<uint64_t>(seconds / elapsed * 1.2)) : 2;
+  }
+
+  const double nsPerOp = elapsed * 1e9 / iterations;
+  const double mbPerSecond = benchmark.bytes(corpus) * iterations / elapsed / (1024 * 1024);
+  printf("%-28s %-8s %14.1f %12.1f %12.2f\n", benchmark.name, corpus.name, nsPerOp, mbPerSecond,
+         static_cast<double>(allocations) / iterations);
+  fflush(stdout);
+}
+
+}  // namespace
+
+void* operator new(size_t size)
+{
+  gAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+int main(int argc, char** argv)
+{
+  const double seconds = argc > 1 ? std::max(0.01, atof(argv[1])) : 0.2;
+  const std::string filter = argc > 2 ? argv[2] : "";
+
+  const std::vector<Corpus> corpora = {MakeCorpus("64B", 64), MakeCorpus("4KB", 4096), MakeCorpus("4MB", 4 << 20)};
+
+  auto textSize = [](const Corpus& corpus) { return corpus.text.size(); };
+
+  std::string scratch;
+  std::vector<std::string_view> views;
+
+  const std::vector<Benchmark> benchmarks = {
+      {"Split vector<string>", textSize,
+       [](const Corpus& corpus) { gSink = gSink + Split(corpus.text, ',').size(); }},
+      {"Split string_view reuse", textSize,
+       [&views](const Corpus& corpus) {
+         Split(corpus.text, ',', views);
+         gSink = gSink + views.size();
+       }},
+      {"SplitView iterate", textSize,
+       [](const Corpus& corpus) {
+         size_t count = 0;
+         for (std::string_view token : SplitView(corpus.text, ','))
+           count += token.size();
+         gSink = gSink + count;
+       }},
+      {"Split map", [](const Corpus& corpus) { return corpus.pairs.size(); },
+       [](const Corpus& corpus) { gSink = gSink + Split(corpus.pairs, ';', '=').size(); }},
+      {"Trim", [](const Corpus& corpus) { return corpus.padded.size(); },
+       [](const Corpus& corpus) { gSink = gSink + Trim(corpus.padded).size(); }},
+      {"ToUpperCase copy", textSize,
+       [](const Corpus& corpus) {
+         gSink = gSink + ToUpperCase(corpus.text, 0, static_cast<uint32_t>(corpus.text.size())).size();
+       }},
+      {"ToLowerCase in place", textSize,
+       [&scratch](const Corpus& corpus) {
+         // Converting the same buffer again costs the same, only copy it when the corpus changes
+         if (scratch.size() != corpus.text.size())
+           scratch = corpus.text;
+         ToLowerCase(scratch);
+         gSink = gSink + static_cast<unsigned char>(scratch[0]);
+       }},
+      {"Format %s %d %.2f", textSize,
+       [](const Corpus& corpus) { gSink = gSink + Format("%s [%d] %.2f", corpus.text, 42, 3.14).size(); }},
+      {"HexToString (each value)", [](const Corpus& corpus) { return corpus.values.size() * sizeof(uint32_t); },
+       [](const Corpus& corpus) {
+         for (uint32_t value : corpus.values)
+           gSink = gSink + HexToString(value).size();
+       }},
+      {"VectorToString", [](const Corpus& corpus) { return corpus.values.size() * sizeof(uint32_t); },
+       [](const Corpus& corpus) { gSink = gSink + VectorToString(corpus.values).size(); }},
+  };
+
+  printf("%-28s %-8s %14s %12s %12s\n", "benchmark", "input", "ns/op", "MB/s", "allocs/op");
+  for (const auto& benchmark : benchmarks)
+  {
+    if (!filter.empty() && std::string_view(benchmark.name).find(filter) == std::string_view::npos)
+      continue;
+
+    for (const auto& corpus : corpora)
+      Measure(benchmark, corpus, seconds);
+  }
+
+  return 0;
+}
@@ -0,0 +1,723 @@
+#include "async_file_io.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io_uring.h"
+
+struct AsyncFileIO::Request
+{
+  enum class Type
+  {
+    Read,
+    Write,
+    Stat,
+    Unlink
+  };
+
+  // Progress of an io_uring request, one operation is in flight at a time
+  enum class Stage
+  {
+    Open,
+    Size,
+    Transfer,
+    Close,
+    Stat,
+    Unlink
+  };
+
+  Type type;
+  std::string path;
+  // Content read or to write
+  std::string data;
+  FileStat stat;
+
+  ReadCallback onRead;
+  StatCallback onStat;
+  DoneCallback onDone;
+
+  Stage stage = Stage::Open;
+  int fd = -1;
+  // Bytes transferred so far
+  size_t done = 0;
+  // First error, reported once the file is closed
+  std::string error;
+  struct statx statx;
+};
+
+class AsyncFileIO::Engine
+{
+public:
+  virtual ~Engine() = default;
+  virtual Backend GetBackend() const = 0;
+  virtual void Submit(std::unique_ptr<Request> request) = 0;
+};
+
+namespace
+{
+
+using Request = AsyncFileIO::Request;
+
+std::string Failure(const Request& request, bool opening, int error)
+{
+  const std::string reason = strerror(error);
+  if (opening)
+    return "Opening file '" + request.path + "' failed: " + reason;
+
+  switch (request.type)
+  {
+    case Request::Type::Read:
+      return "Can't read the file '" + request.path + "': " + reason;
+    case Request::Type::Write:
+      return "Can't write the file " + request.path + ": " + reason;
+    case Request::Type::Stat:
+      return "Can't stat the file '" + request.path + "': " + reason;
+    default:
+      return "Can't delete the file '" + request.path + "': " + reason;
+  }
+}
+
+void Complete(Request& request)
+{
+  const bool failed = !request.error.empty();
+  switch (request.type)
+  {
+    case Request::Type::Read:
+      request.onRead(failed ? Result<std::string>::Failed(request.error) : Result<std::string>(std::move(request.data)));
+      break;
+    case Request::Type::Stat:
+      request.onStat(failed ? Result<FileStat>::Failed(request.error) : Result<FileStat>(request.stat));
+      break;
+    default:
+      request.onDone(failed ? VoidResult::Failed(request.error) : VoidResult());
+      break;
+  }
+}
+
+// ------------------------------------------------------------------------------------------------------------
+// Thread pool, plain blocking calls
+
+int OpenFile(const std::string& path, int flags)
+{
+  int fd;
+  do
+  {
+    fd = open(path.c_str(), flags | O_CLOEXEC, 0666);
+  } while (fd < 0 && errno == EINTR);
+  return fd;
+}
+
+void ReadBlocking(Request& request)
+{
+  const int fd = OpenFile(request.path, O_RDONLY);
+  if (fd < 0)
+  {
+    request.error = Failure(request, true, errno);
+    return;
+  }
+
+  // Sized from fstat, so a regular file is read with one call plus the one seeing EOF
+  struct stat st;
+  const size_t size = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? st.st_size : 0;
+  request.data.resize(size ? size + 1 : 4096);
+  for (;;)
+  {
+    if (request.done == request.data.size())
+      request.data.resize(request.data.size() * 2);
+
+    const ssize_t count = read(fd, &request.data[request.done], request.data.size() - request.done);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0)
+    {
+      request.error = Failure(request, false, errno);
+      break;
+    }
+    if (count == 0)
+      break;
+    request.done += count;
+  }
+  request.data.resize(request.done);
+  close(fd);
+}
+
+void WriteBlocking(Request& request)
+{
+  const int fd = OpenFile(request.path, O_WRONLY | O_CREAT | O_TRUNC);
+  if (fd < 0)
+  {
+    request.error = Failure(request, true, errno);
+    return;
+  }
+
+  while (request.done < request.data.size())
+  {
+    const ssize_t count = write(fd, request.data.data() + request.done, request.data.size() - request.done);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0)
+    {
+      request.error = Failure(request, false, errno);
+      break;
+    }
+    request.done += count;
+  }
+
+  if (close(fd) != 0 && request.error.empty())
+    request.error = Failure(request, false, errno);
+}
+
+void RunBlocking(Request& request)
+{
+  switch (request.type)
+  {
+    case Request::Type::Read:
+      ReadBlocking(request);
+      break;
+    case Request::Type::Write:
+      WriteBlocking(request);
+      break;
+    case Request::Type::Stat:
+    {
+      struct stat st;
+      if (stat(request.path.c_str(), &st) != 0)
+      {
+        request.error = Failure(request, false, errno);
+        break;
+      }
+      request.stat.size = st.st_size;
+      request.stat.mode = st.st_mode;
+      request.stat.modified = std::chrono::system_clock::time_point(
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::seconds(st.st_mtim.tv_sec) + std::chrono::nanoseconds(st.st_mtim.tv_nsec)));
+      break;
+    }
+    case Request::Type::Unlink:
+      if (unlink(request.path.c_str()) != 0)
+        request.error = Failure(request, false, errno);
+      break;
+  }
+}
+
+class ThreadPoolEngine : public AsyncFileIO::Engine
+{
+public:
+  explicit ThreadPoolEngine(uint32_t threads)
+  {
+    for (uint32_t i = 0; i < std::max(1u, threads); ++i)
+      mWorkers.emplace_back([this]() { Work(); });
+  }
+
+  ~ThreadPoolEngine()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStopping = true;
+      mCondition.notify_all();
+    }
+    for (auto& worker : mWorkers)
+      worker.join();
+  }
+
+  AsyncFileIO::Backend GetBackend() const override
+  {
+    return AsyncFileIO::Backend::ThreadPool;
+  }
+
+  void Submit(std::unique_ptr<Request> request) override
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueue.push_back(std::move(request));
+    mCondition.notify_one();
+  }
+
+private:
+  void Work()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+      // Requests queued before stopping are still run
+      mCondition.wait(lock, [this]() { return !mQueue.empty() || mStopping; });
+      if (mQueue.empty())
+        return;
+
+      std::unique_ptr<Request> request = std::move(mQueue.front());
+      mQueue.pop_front();
+      lock.unlock();
+
+      RunBlocking(*request);
+      Complete(*request);
+
+      lock.lock();
+    }
+  }
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::deque<std::unique_ptr<Request>> mQueue;
+  bool mStopping = false;
+  std::vector<std::thread> mWorkers;
+};
+
+// ------------------------------------------------------------------------------------------------------------
+// io_uring, one thread submits and completes every request
+
+// Operations the engine needs, added in 5.6 (5.11 for UNLINKAT)
+constexpr uint8_t REQUIRED_OPS[] = {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE,
+                                    IORING_OP_CLOSE, IORING_OP_UNLINKAT, IORING_OP_POLL_ADD};
+
+// user_data of the poll on the wake-up eventfd, requests use their address
+constexpr uint64_t WAKE_UP = 0;
+
+class IoUringEngine : public AsyncFileIO::Engine
+{
+public:
+  // nullptr when io_uring is not usable
+  static std::unique_ptr<IoUringEngine> Create(uint32_t queueDepth)
+  {
+    std::unique_ptr<IoUringEngine> engine(new IoUringEngine(std::max(1u, queueDepth)));
+    if (!engine->mRing.Init(engine->mQueueDepth + 1).IsSuccess())
+      return nullptr;
+    for (uint8_t op : REQUIRED_OPS)
+    {
+      if (!engine->mRing.Supports(op))
+        return nullptr;
+    }
+
+    engine->mEventFd = eventfd(0, EFD_CLOEXEC);
+    if (engine->mEventFd < 0)
+      return nullptr;
+
+    engine->mThread = std::thread([engine = engine.get()]() { engine->Run(); });
+    return engine;
+  }
+
+  ~IoUringEngine()
+  {
+    if (mThread.joinable())
+    {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+      }
+      WakeUp();
+      mThread.join();
+    }
+    if (mEventFd >= 0)
+      close(mEventFd);
+  }
+
+  AsyncFileIO::Backend GetBackend() const override
+  {
+    return AsyncFileIO::Backend::IoUring;
+  }
+
+  void Submit(std::unique_ptr<Request> request) override
+  {
+    bool wakeUp;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQueue.push_back(std::move(request));
+      // One wake-up for every request queued while the I/O thread is busy
+      wakeUp = !mWokenUp;
+      mWokenUp = true;
+    }
+    if (wakeUp)
+      WakeUp();
+  }
+
+private:
+  explicit IoUringEngine(uint32_t queueDepth)
+      : mQueueDepth(queueDepth)
+  {
+  }
+
+  void WakeUp()
+  {
+    const uint64_t one = 1;
+    while (write(mEventFd, &one, sizeof(one)) < 0 && errno == EINTR)
+    {
+    }
+  }
+
+  io_uring_sqe* NextSqe()
+  {
+    // Every request has at most one entry queued and the ring has room for all of them,
+    // submitting first is only a safety net
+    io_uring_sqe* sqe = mRing.GetSqe();
+    while (!sqe)
+    {
+      mRing.Submit(0);
+      sqe = mRing.GetSqe();
+    }
+    return sqe;
+  }
+
+  void ArmWakeUp()
+  {
+    io_uring_sqe* sqe = NextSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = mEventFd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = WAKE_UP;
+  }
+
+  void Queue(Request& request, uint8_t opcode, int fd)
+  {
+    io_uring_sqe* sqe = NextSqe();
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = reinterpret_cast<uint64_t>(&request);
+
+    switch (request.stage)
+    {
+      case Request::Stage::Open:
+        sqe->addr = reinterpret_cast<uint64_t>(request.path.c_str());
+        sqe->len = 0666;
+        sqe->open_flags = O_CLOEXEC | (request.type == Request::Type::Read ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC);
+        break;
+      case Request::Stage::Size:
+      case Request::Stage::Stat:
+        sqe->addr = reinterpret_cast<uint64_t>(request.stage == Request::Stage::Size ? "" : request.path.c_str());
+        sqe->len = STATX_BASIC_STATS;
+        sqe->statx_flags = request.stage == Request::Stage::Size ? AT_EMPTY_PATH : 0;
+        sqe->off = reinterpret_cast<uint64_t>(&request.statx);
+        break;
+      case Request::Stage::Transfer:
+        sqe->addr = reinterpret_cast<uint64_t>(&request.data[request.done]);
+        sqe->len = static_cast<uint32_t>(std::min<size_t>(request.data.size() - request.done, UINT32_MAX));
+        sqe->off = request.done;
+        break;
+      case Request::Stage::Unlink:
+        sqe->addr = reinterpret_cast<uint64_t>(request.path.c_str());
+        break;
+      case Request::Stage::Close:
+        break;
+    }
+  }
+
+  void Start(Request& request)
+  {
+    switch (request.type)
+    {
+      case Request::Type::Read:
+      case Request::Type::Write:
+        request.stage = Request::Stage::Open;
+        Queue(request, IORING_OP_OPENAT, AT_FDCWD);
+        break;
+      case Request::Type::Stat:
+        request.stage = Request::Stage::Stat;
+        Queue(request, IORING_OP_STATX, AT_FDCWD);
+        break;
+      case Request::Type::Unlink:
+        request.stage = Request::Stage::Unlink;
+        Queue(request, IORING_OP_UNLINKAT, AT_FDCWD);
+        break;
+    }
+  }
+
+  void CloseFile(Request& request)
+  {
+    request.stage = Request::Stage::Close;
+    Queue(request, IORING_OP_CLOSE, request.fd);
+  }
+
+  // Handles the completion of the operation in flight and queues the next one.
+  // True once the request is finished.
+  bool Advance(Request& request, int res)
+  {
+    const bool isRead = request.type == Request::Type::Read;
+    if (res == -EINTR || res == -EAGAIN)
+    {
+      Queue(request, OpCode(request), StageFd(request));
+      return false;
+    }
+
+    switch (request.stage)
+    {
+      case Request::Stage::Open:
+        if (res < 0)
+        {
+          request.error = Failure(request, true, -res);
+          return true;
+        }
+        request.fd = res;
+        if (isRead)
+        {
+          request.stage = Request::Stage::Size;
+          Queue(request, IORING_OP_STATX, request.fd);
+        }
+        else
+        {
+          Transfer(request);
+        }
+        return false;
+
+      case Request::Stage::Size:
+      {
+        // Sized so a regular file is read with one operation plus the one seeing EOF
+        const size_t size = res == 0 && S_ISREG(request.statx.stx_mode) ? request.statx.stx_size : 0;
+        request.data.resize(size ? size + 1 : 4096);
+        Transfer(request);
+        return false;
+      }
+
+      case Request::Stage::Transfer:
+        if (res < 0)
+        {
+          request.error = Failure(request, false, -res);
+          CloseFile(request);
+          return false;
+        }
+
+        request.done += res;
+        if (isRead)
+        {
+          // Reads can be short (2GB per call, FUSE, NFS), only 0 means the end was reached
+          if (res == 0)
+          {
+            request.data.resize(request.done);
+            CloseFile(request);
+            return false;
+          }
+          if (request.done == request.data.size())
+            request.data.resize(request.data.size() * 2);
+        }
+        Transfer(request);
+        return false;
+
+      case Request::Stage::Close:
+        if (res < 0 && request.error.empty() && !isRead)
+          request.error = Failure(request, false, -res);
+        return true;
+
+      case Request::Stage::Stat:
+        if (res < 0)
+        {
+          request.error = Failure(request, false, -res);
+          return true;
+        }
+        request.stat.size = request.statx.stx_size;
+        request.stat.mode = request.statx.stx_mode;
+        request.stat.modified = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(request.statx.stx_mtime.tv_sec) + std::chrono::nanoseconds(request.statx.stx_mtime.tv_nsec)));
+        return true;
+
+      case Request::Stage::Unlink:
+        if (res < 0)
+          request.error = Failure(request, false, -res);
+        return true;
+    }
+    return true;
+  }
+
+  // Queues the next read or write, or the close once everything was written
+  void Transfer(Request& request)
+  {
+    if (request.type == Request::Type::Write && request.done == request.data.size())
+    {
+      CloseFile(request);
+      return;
+    }
+
+    request.stage = Request::Stage::Transfer;
+    Queue(request, request.type == Request::Type::Read ? IORING_OP_READ : IORING_OP_WRITE, request.fd);
+  }
+
+  // Descriptor of the operation of the current stage, path based ones use the working directory
+  static int StageFd(const Request& request)
+  {
+    switch (request.stage)
+    {
+      case Request::Stage::Open:
+      case Request::Stage::Stat:
+      case Request::Stage::Unlink:
+        return AT_FDCWD;
+      default:
+        return request.fd;
+    }
+  }
+
+  static uint8_t OpCode(const Request& request)
+  {
+    switch (request.stage)
+    {
+      case Request::Stage::Open:
+        return IORING_OP_OPENAT;
+      case Request::Stage::Size:
+      case Request::Stage::Stat:
+        return IORING_OP_STATX;
+      case Request::Stage::Transfer:
+        return request.type == Request::Type::Read ? IORING_OP_READ : IORING_OP_WRITE;
+      case Request::Stage::Close:
+        return IORING_OP_CLOSE;
+      default:
+        return IORING_OP_UNLINKAT;
+    }
+  }
+
+  void Run()
+  {
+    std::deque<std::unique_ptr<Request>> waiting;
+    uint32_t inFlight = 0;
+
+    ArmWakeUp();
+    for (;;)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& request : mQueue)
+          waiting.push_back(std::move(request));
+        mQueue.clear();
+        mWokenUp = false;
+        if (mStopping && waiting.empty() && inFlight == 0)
+          return;
+      }
+
+      while (!waiting.empty() && inFlight < mQueueDepth)
+      {
+        Start(*waiting.front().release());
+        waiting.pop_front();
+        ++inFlight;
+      }
+
+      // One system call submits everything queued above and waits for the next completion
+      mRing.Submit(1);
+      mRing.ForEachCompletion([&](uint64_t userData, int res) {
+        if (userData == WAKE_UP)
+        {
+          uint64_t count;
+          while (read(mEventFd, &count, sizeof(count)) < 0 && errno == EINTR)
+          {
+          }
+          ArmWakeUp();
+          return;
+        }
+
+        Request* request = reinterpret_cast<Request*>(userData);
+        if (Advance(*request, res))
+        {
+          --inFlight;
+          Complete(*request);
+          delete request;
+        }
+      });
+    }
+  }
+
+  IoUring mRing;
+  const uint32_t mQueueDepth;
+  int mEventFd = -1;
+  std::thread mThread;
+
+  std::mutex mMutex;
+  std::deque<std::unique_ptr<Request>> mQueue;
+  // The eventfd was written and the I/O thread did not take the queue yet
+  bool mWokenUp = false;
+  bool mStopping = false;
+};
+
+template <class T>
+std::future<T> Promise(std::function<void(const T&)>& callback)
+{
+  auto promise = std::make_shared<std::promise<T>>();
+  callback = [promise](const T& result) { promise->set_value(result); };
+  return promise->get_future();
+}
+
+}  // namespace
+
+AsyncFileIO::AsyncFileIO(const AsyncFileIOOptions& options)
+{
+  if (options.useIoUring)
+    mEngine = IoUringEngine::Create(options.queueDepth);
+  if (!mEngine)
+    mEngine = std::make_unique<ThreadPoolEngine>(options.threads);
+}
+
+AsyncFileIO::~AsyncFileIO() = default;
+
+AsyncFileIO::Backend AsyncFileIO::GetBackend() const
+{
+  return mEngine->GetBackend();
+}
+
+void AsyncFileIO::ReadFile(const std::string& path, ReadCallback callback)
+{
+  auto request = std::make_unique<Request>();
+  request->type = Request::Type::Read;
+  request->path = path;
+  request->onRead = std::move(callback);
+  mEngine->Submit(std::move(request));
+}
+
+std::future<Result<std::string>> AsyncFileIO::ReadFile(const std::string& path)
+{
+  ReadCallback callback;
+  auto future = Promise(callback);
+  ReadFile(path, std::move(callback));
+  return future;
+}
+
+void AsyncFileIO::WriteFile(const std::string& path, std::string data, DoneCallback callback)
+{
+  auto request = std::make_unique<Request>();
+  request->type = Request::Type::Write;
+  request->path = path;
+  request->data = std::move(data);
+  request->onDone = std::move(callback);
+  mEngine->Submit(std::move(request));
+}
+
+std::future<VoidResult> AsyncFileIO::WriteFile(const std::string& path, std::string data)
+{
+  DoneCallback callback;
+  auto future = Promise(callback);
+  WriteFile(path, std::move(data), std::move(callback));
+  return future;
+}
+
+void AsyncFileIO::Stat(const std::string& path, StatCallback callback)
+{
+  auto request = std::make_unique<Request>();
+  request->type = Request::Type::Stat;
+  request->path = path;
+  request->onStat = std::move(callback);
+  mEngine->Submit(std::move(request));
+}
+
+std::future<Result<FileStat>> AsyncFileIO::Stat(const std::string& path)
+{
+  StatCallback callback;
+  auto future = Promise(callback);
+  Stat(path, std::move(callback));
+  return future;
+}
+
+void AsyncFileIO::Unlink(const std::string& path, DoneCallback callback)
+{
+  auto request = std::make_unique<Request>();
+  request->type = Request::Type::Unlink;
+  request->path = path;
+  request->onDone = std::move(callback);
+  mEngine->Submit(std::move(request));
+}
+
+std::future<VoidResult> AsyncFileIO::Unlink(const std::string& path)
+{
+  DoneCallback callback;
+  auto future = Promise(callback);
+  Unlink(path, std::move(callback));
+  return future;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "result.h"
+
+struct FileStat
+{
+  uint64_t size = 0;
+  // st_mode, type and permission bits
+  uint32_t mode = 0;
+  std::chrono::system_clock::time_point modified;
+};
+
+struct AsyncFileIOOptions
+{
+  // Operations in flight at once, further ones wait in a queue
+  uint32_t queueDepth = 256;
+  // Use io_uring when the kernel supports it, otherwise a pool of worker threads
+  bool useIoUring = true;
+  // Workers of the thread pool fallback
+  uint32_t threads = 4;
+};
+
+// Runs whole-file operations asynchronously, for jobs touching many small files. With
+// io_uring, all operations requested while the previous ones are in flight are submitted
+// together with a single system call and processed by the kernel in parallel. Without it,
+// they are spread over a thread pool.
+// Completions are delivered as futures or callbacks. Callbacks run on the I/O thread and
+// should be short; they may request further operations.
+class AsyncFileIO
+{
+public:
+  enum class Backend
+  {
+    IoUring,
+    ThreadPool
+  };
+
+  using ReadCallback = std::function<void(const Result<std::string>&)>;
+  using StatCallback = std::function<void(const Result<FileStat>&)>;
+  using DoneCallback = std::function<void(const VoidResult&)>;
+
+  explicit AsyncFileIO(const AsyncFileIOOptions& options = AsyncFileIOOptions());
+  // Waits for all requested operations
+  ~AsyncFileIO();
+
+  AsyncFileIO(const AsyncFileIO&) = delete;
+  AsyncFileIO& operator=(const AsyncFileIO&) = delete;
+
+  Backend GetBackend() const;
+
+  // Whole content of the file
+  void ReadFile(const std::string& path, ReadCallback callback);
+  std::future<Result<std::string>> ReadFile(const std::string& path);
+
+  // Creates or truncates the file
+  void WriteFile(const std::string& path, std::string data, DoneCallback callback);
+  std::future<VoidResult> WriteFile(const std::string& path, std::string data);
+
+  // Follows symlinks
+  void Stat(const std::string& path, StatCallback callback);
+  std::future<Result<FileStat>> Stat(const std::string& path);
+
+  void Unlink(const std::string& path, DoneCallback callback);
+  std::future<VoidResult> Unlink(const std::string& path);
+
+  // Defined in async_file_io.cpp
+  struct Request;
+  class Engine;
+
+private:
+  std::unique_ptr<Engine> mEngine;
+};
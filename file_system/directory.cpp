@@ -0,0 +1,305 @@
+#include "directory.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace
+{
+
+// Entries are read in batches of this many bytes, about 2000 entries with short names
+constexpr size_t DIRENT_BUFFER_SIZE = 64 * 1024;
+
+// Layout returned by getdents64, glibc does not declare it
+struct LinuxDirent64
+{
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+EntryType FromMode(mode_t mode)
+{
+  if (S_ISREG(mode))
+    return EntryType::File;
+  if (S_ISDIR(mode))
+    return EntryType::Directory;
+  if (S_ISLNK(mode))
+    return EntryType::Symlink;
+  return EntryType::Other;
+}
+
+EntryType FromDirentType(int dirFd, const char* name, unsigned char type)
+{
+  switch (type)
+  {
+    case DT_REG:
+      return EntryType::File;
+    case DT_DIR:
+      return EntryType::Directory;
+    case DT_LNK:
+      return EntryType::Symlink;
+    case DT_UNKNOWN:
+    {
+      struct stat st;
+      return fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 ? FromMode(st.st_mode) : EntryType::Other;
+    }
+    default:
+      return EntryType::Other;
+  }
+}
+
+uint32_t TypeMask(EntryType type)
+{
+  return 1 << static_cast<uint32_t>(type);
+}
+
+bool IsHidden(const char* name)
+{
+  return name[0] == '.';
+}
+
+int OpenDirectory(const std::string& path)
+{
+  int fd;
+  do
+  {
+    fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  } while (fd < 0 && errno == EINTR);
+  return fd;
+}
+
+VoidResult OpenFailed(const std::string& path)
+{
+  return VoidResult::Failed("Opening directory '" + path + "' failed: " + std::string(strerror(errno)));
+}
+
+// Calls onEntry(name, type) for every entry of the open directory fd but "." and "..",
+// stops once it returns false
+template <class F>
+VoidResult ReadEntries(int fd, const std::string& path, std::vector<char>& buffer, F&& onEntry)
+{
+  buffer.resize(DIRENT_BUFFER_SIZE);
+  for (;;)
+  {
+    const long read = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+    if (read < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return VoidResult::Failed("Reading directory '" + path + "' failed: " + std::string(strerror(errno)));
+    }
+    if (read == 0)
+      return VoidResult();
+
+    for (long pos = 0; pos < read;)
+    {
+      const auto* dirent = reinterpret_cast<const LinuxDirent64*>(buffer.data() + pos);
+      pos += dirent->d_reclen;
+
+      const char* name = dirent->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+        continue;
+
+      if (!onEntry(name, FromDirentType(fd, name, dirent->d_type)))
+        return VoidResult();
+    }
+  }
+}
+
+class Walker
+{
+public:
+  Walker(const WalkOptions& options, const std::function<bool(const WalkEntry&)>& onEntry)
+      : mOptions(options)
+      , mOnEntry(onEntry)
+  {
+  }
+
+  VoidResult Run(const std::string& root)
+  {
+    // The root must be readable, errors below it are collected while walking on
+    const int fd = OpenDirectory(root);
+    if (fd < 0)
+      return OpenFailed(root);
+
+    std::vector<char> buffer;
+    std::vector<std::pair<std::string, uint32_t>> subdirectories;
+    VisitDirectory(fd, root, 0, buffer, subdirectories);
+    Push(subdirectories);
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < mOptions.threads; ++i)
+      workers.emplace_back([this]() { Work(); });
+    Work();
+    for (auto& worker : workers)
+      worker.join();
+
+    return mError.empty() ? VoidResult() : VoidResult::Failed(mError);
+  }
+
+private:
+  void Work()
+  {
+    std::vector<char> buffer;
+    std::vector<std::pair<std::string, uint32_t>> subdirectories;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+      mCondition.wait(lock, [this]() { return !mPending.empty() || mActive == 0 || mStopped; });
+      if (mPending.empty() || mStopped)
+        break;
+
+      // Last in, first out keeps the traversal roughly depth first and the queue short
+      auto [path, depth] = std::move(mPending.back());
+      mPending.pop_back();
+      ++mActive;
+      lock.unlock();
+
+      const int fd = OpenDirectory(path);
+      if (fd < 0)
+        SetError(OpenFailed(path).ErrorMessage());
+      else
+        VisitDirectory(fd, path, depth, buffer, subdirectories);
+
+      lock.lock();
+      --mActive;
+      for (auto& subdirectory : subdirectories)
+        mPending.push_back(std::move(subdirectory));
+      subdirectories.clear();
+      mCondition.notify_all();
+    }
+    mCondition.notify_all();
+  }
+
+  void Push(std::vector<std::pair<std::string, uint32_t>>& subdirectories)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& subdirectory : subdirectories)
+      mPending.push_back(std::move(subdirectory));
+    subdirectories.clear();
+  }
+
+  // Reports the entries of fd (closed on return) and collects the subdirectories to visit
+  void VisitDirectory(int fd, const std::string& path, uint32_t depth, std::vector<char>& buffer,
+                      std::vector<std::pair<std::string, uint32_t>>& subdirectories)
+  {
+    if (mOptions.followSymlinks && !FirstVisit(fd))
+    {
+      close(fd);
+      return;
+    }
+
+    const std::string prefix = !path.empty() && path.back() == '/' ? path : path + '/';
+    VoidResult result = ReadEntries(fd, path, buffer, [&](const char* name, EntryType type) {
+      if (!mOptions.includeHidden && IsHidden(name))
+        return true;
+
+      if (type == EntryType::Symlink && mOptions.followSymlinks)
+      {
+        struct stat st;
+        if (fstatat(fd, name, &st, 0) == 0)
+          type = FromMode(st.st_mode);
+      }
+
+      WalkEntry entry{prefix + name, std::string_view(), type, depth + 1};
+      entry.name = std::string_view(entry.path).substr(prefix.size());
+
+      if (mOptions.exclude && mOptions.exclude(entry))
+        return true;
+
+      if ((mOptions.types & TypeMask(type)) && (!mOptions.include || mOptions.include(entry)) && !mOnEntry(entry))
+      {
+        Stop();
+        return false;
+      }
+
+      if (type == EntryType::Directory && entry.depth < mOptions.maxDepth)
+        subdirectories.emplace_back(std::move(entry.path), entry.depth);
+
+      return !mStopped.load(std::memory_order_relaxed);
+    });
+    close(fd);
+
+    if (!result.IsSuccess())
+      SetError(result.ErrorMessage());
+  }
+
+  // With symlinks followed the same directory can be reached twice, or through a loop
+  bool FirstVisit(int fd)
+  {
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+      return true;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mVisited.emplace(st.st_dev, st.st_ino).second;
+  }
+
+  void Stop()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopped = true;
+    mCondition.notify_all();
+  }
+
+  void SetError(const std::string& error)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mError.empty())
+      mError = error;
+  }
+
+  const WalkOptions& mOptions;
+  const std::function<bool(const WalkEntry&)>& mOnEntry;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  // Directories left to visit and their depth
+  std::vector<std::pair<std::string, uint32_t>> mPending;
+  // Directories being visited
+  uint32_t mActive = 0;
+  std::atomic<bool> mStopped{false};
+  std::set<std::pair<dev_t, ino_t>> mVisited;
+  std::string mError;
+};
+
+}  // namespace
+
+VoidResult ListDirectory(const std::string& path, std::vector<DirectoryEntry>& entries, uint32_t types,
+                         bool includeHidden)
+{
+  entries.clear();
+
+  const int fd = OpenDirectory(path);
+  if (fd < 0)
+    return OpenFailed(path);
+
+  std::vector<char> buffer;
+  VoidResult result = ReadEntries(fd, path, buffer, [&](const char* name, EntryType type) {
+    if ((types & TypeMask(type)) && (includeHidden || !IsHidden(name)))
+      entries.push_back({name, type});
+    return true;
+  });
+  close(fd);
+  return result;
+}
+
+VoidResult WalkDirectory(const std::string& root, const WalkOptions& options,
+                         const std::function<bool(const WalkEntry&)>& onEntry)
+{
+  return Walker(options, onEntry).Run(root);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "result.h"
+
+enum class EntryType : uint8_t
+{
+  File,
+  Directory,
+  Symlink,
+  // Devices, sockets, fifos
+  Other
+};
+
+// Masks for the types to list, e.g. LIST_FILES | LIST_DIRECTORIES
+constexpr uint32_t LIST_FILES = 1 << static_cast<uint32_t>(EntryType::File);
+constexpr uint32_t LIST_DIRECTORIES = 1 << static_cast<uint32_t>(EntryType::Directory);
+constexpr uint32_t LIST_SYMLINKS = 1 << static_cast<uint32_t>(EntryType::Symlink);
+constexpr uint32_t LIST_OTHER = 1 << static_cast<uint32_t>(EntryType::Other);
+constexpr uint32_t LIST_ALL = LIST_FILES | LIST_DIRECTORIES | LIST_SYMLINKS | LIST_OTHER;
+
+struct DirectoryEntry
+{
+  std::string name;
+  // Symlinks are not followed
+  EntryType type;
+};
+
+// Fills entries (cleared first) with the entries of path in directory order, "." and ".."
+// excluded. Reads the directory with getdents64 in large batches and takes the type from
+// d_type, so no stat is needed except on file systems that do not report it.
+VoidResult ListDirectory(const std::string& path, std::vector<DirectoryEntry>& entries, uint32_t types = LIST_ALL,
+                         bool includeHidden = true);
+
+struct WalkEntry
+{
+  // Root joined with the path relative to it
+  std::string path;
+  // Last component of path
+  std::string_view name;
+  EntryType type;
+  // 1 for the entries directly in the root
+  uint32_t depth;
+};
+
+struct WalkOptions
+{
+  // Types passed to the callback, directories are descended into either way
+  uint32_t types = LIST_ALL;
+  bool includeHidden = true;
+  // Entries rejected by include are not reported but directories are still descended into
+  std::function<bool(const WalkEntry&)> include;
+  // Entries matching exclude are neither reported nor descended into
+  std::function<bool(const WalkEntry&)> exclude;
+  // Report symlinks by the type of their target and descend into linked directories,
+  // each directory is visited once even if linked several times
+  bool followSymlinks = false;
+  // Directories at this depth are reported but not descended into
+  uint32_t maxDepth = UINT32_MAX;
+  // Above 1, directories are read in parallel and the callbacks are called concurrently
+  uint32_t threads = 1;
+};
+
+// Calls onEntry for every entry below root, in no particular order. Walking stops once
+// onEntry returns false. Directories that cannot be read are skipped, the walk then
+// still covers the rest of the tree but returns the first error.
+VoidResult WalkDirectory(const std::string& root, const WalkOptions& options,
+                         const std::function<bool(const WalkEntry&)>& onEntry);
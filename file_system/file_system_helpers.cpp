@@ -1,14 +1,17 @@
 #include "file_system_helpers.h"
 
+#include <fcntl.h>
 #include <libgen.h>
 #include <sys/stat.h>
 #include <unistd.h>  //using access, X_OK, F_OK
+#include <algorithm>
+#include <atomic>
 #include <climits>
 #include <cstring>
 #include <cstdlib>
 #include <fstream>
 
-#include "sync_process.h"
+#include "directory.h"
 
 bool IsCommandExecutable(const std::string& command)
 {
@@ -98,9 +101,29 @@ VoidResult CreateDirectory(const std::string& path)
 
 std::vector<std::string> GetFilesInDirectory(const std::string& path)
 {
-  std::string output;
-  SyncProcess::Execute("ls -p " + path, output);
-  return Split(output, '\n');
+  // Same output as "ls -p": hidden entries skipped, '/' appended to directories, sorted
+  std::vector<std::string> files;
+  std::vector<DirectoryEntry> entries;
+  if (!ListDirectory(path, entries, LIST_ALL, false).IsSuccess())
+  {
+    // "ls -p" prints a path to anything but a directory as given
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && !S_ISDIR(st.st_mode))
+      files.push_back(path);
+    return files;
+  }
+
+  // Sorted by name before the '/' is appended, "a/" comes before "a.txt"
+  std::sort(entries.begin(), entries.end(), [](const DirectoryEntry& a, const DirectoryEntry& b) { return a.name < b.name; });
+
+  files.reserve(entries.size());
+  for (DirectoryEntry& entry : entries)
+  {
+    if (entry.type == EntryType::Directory)
+      entry.name += '/';
+    files.push_back(std::move(entry.name));
+  }
+  return files;
 }
 
 Result<std::string> GetFileContents(const char* fpath)
@@ -126,7 +149,10 @@ Result<std::string> GetFileContents(const std::string& fpath)
   return GetFileContents(fpath.c_str());
 }
 
-VoidResult SetFileContents(const std::string& fpath, const std::string& value)
+namespace
+{
+
+VoidResult WriteInPlace(const std::string& fpath, std::string_view value)
 {
   try
   {
@@ -143,3 +169,78 @@ VoidResult SetFileContents(const std::string& fpath, const std::string& value)
 
   return VoidResult();
 }
+
+VoidResult WriteAll(int fd, std::string_view value)
+{
+  while (!value.empty())
+  {
+    const ssize_t written = write(fd, value.data(), value.size());
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return VoidResult::Failed(strerror(errno));
+    }
+    value.remove_prefix(written);
+  }
+  return VoidResult();
+}
+
+VoidResult WriteAtomic(const std::string& fpath, std::string_view value, bool durable)
+{
+  static std::atomic<uint32_t> counter{0};
+
+  // Created next to the file so the rename stays within one file system. Opened with the
+  // default permissions (minus umask) like a new file, or given those of the replaced one.
+  std::string tmpPath;
+  int fd = -1;
+  for (uint32_t attempt = 0; fd < 0 && attempt < 100; ++attempt)
+  {
+    tmpPath = fpath + ".tmp." + std::to_string(getpid()) + "." + std::to_string(counter++);
+    fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd < 0 && errno != EEXIST)
+      break;
+  }
+  if (fd < 0)
+    return VoidResult::Failed("Can't create a temporary file for '" + fpath + "': " + std::string(strerror(errno)));
+
+  struct stat st;
+  if (stat(fpath.c_str(), &st) == 0)
+    fchmod(fd, st.st_mode & 07777);
+
+  VoidResult result = WriteAll(fd, value);
+  if (result.IsSuccess() && fsync(fd) != 0)
+    result = VoidResult::Failed(strerror(errno));
+  if (close(fd) != 0 && result.IsSuccess())
+    result = VoidResult::Failed(strerror(errno));
+  if (result.IsSuccess() && rename(tmpPath.c_str(), fpath.c_str()) != 0)
+    result = VoidResult::Failed(strerror(errno));
+
+  if (!result.IsSuccess())
+  {
+    unlink(tmpPath.c_str());
+    return VoidResult::Failed("Can't write the file " + fpath + ": " + result.ErrorMessage());
+  }
+
+  if (durable)
+  {
+    const std::string dir = RemoveFilename(fpath);
+    const int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0 || fsync(dirFd) != 0)
+      result = VoidResult::Failed("Can't sync the directory of " + fpath + ": " + std::string(strerror(errno)));
+    if (dirFd >= 0)
+      close(dirFd);
+  }
+
+  return result;
+}
+
+}  // namespace
+
+VoidResult SetFileContents(const std::string& fpath, std::string_view value, WriteMode mode)
+{
+  if (mode == WriteMode::InPlace)
+    return WriteInPlace(fpath, value);
+
+  return WriteAtomic(fpath, value, mode == WriteMode::Durable);
+}
@@ -14,8 +14,22 @@ std::string GetFilename(const std::string& path);
 std::string RemoveFilename(const std::string& path);
 
 VoidResult CreateDirectory(const std::string& path);
+// Names in path as "ls -p" prints them: sorted, hidden ones skipped and directories ending in '/'.
+// Like "ls -p", a path that is not a directory gives just that path.
+// See directory.h for typed listings and recursive walks.
 std::vector<std::string> GetFilesInDirectory(const std::string& path);
 
 Result<std::string> GetFileContents(const char* fpath);
 Result<std::string> GetFileContents(const std::string& fpath);
-VoidResult SetFileContents(const std::string& fpath, const std::string& value);
+enum class WriteMode
+{
+  // Truncates and rewrites the file, readers can see partial content
+  InPlace,
+  // Writes and fsyncs a temporary file next to it, then renames it over the file.
+  // Readers see either the old or the new content, also after a crash.
+  Atomic,
+  // Atomic, and the directory is fsynced so the rename itself survives a power loss
+  Durable
+};
+
+VoidResult SetFileContents(const std::string& fpath, std::string_view value, WriteMode mode = WriteMode::InPlace);
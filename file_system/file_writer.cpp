@@ -0,0 +1,155 @@
+#include "file_writer.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+FileWriter::FileWriter(size_t bufferSize)
+    : mBuffer(new char[bufferSize ? bufferSize : 1])
+    , mBufferSize(bufferSize ? bufferSize : 1)
+{
+}
+
+FileWriter::~FileWriter()
+{
+  Close();
+}
+
+VoidResult FileWriter::Open(const std::string& path, bool truncate)
+{
+  if (IsOpen())
+  {
+    VoidResult closed = Close();
+    if (!closed.IsSuccess())
+      return closed;
+  }
+
+  mFd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0666);
+  if (mFd < 0)
+    return VoidResult::Failed("Can't open file '" + path + "': " + std::string(strerror(errno)));
+
+  struct stat st;
+  if (fstat(mFd, &st) != 0)
+  {
+    const std::string error = strerror(errno);
+    close(mFd);
+    mFd = -1;
+    return VoidResult::Failed("Can't stat file '" + path + "': " + error);
+  }
+
+  mPath = path;
+  mOffset = st.st_size;
+  mBuffered = 0;
+  return VoidResult();
+}
+
+VoidResult FileWriter::Close()
+{
+  if (!IsOpen())
+    return VoidResult();
+
+  VoidResult result = Flush();
+  if (close(mFd) != 0 && result.IsSuccess())
+    result = VoidResult::Failed("Can't close file '" + mPath + "': " + std::string(strerror(errno)));
+  mFd = -1;
+  return result;
+}
+
+bool FileWriter::IsOpen() const
+{
+  return mFd >= 0;
+}
+
+VoidResult FileWriter::Append(std::string_view data)
+{
+  if (data.size() <= mBufferSize - mBuffered)
+  {
+    memcpy(mBuffer.get() + mBuffered, data.data(), data.size());
+    mBuffered += data.size();
+    return VoidResult();
+  }
+
+  // Does not fit, write what is buffered and the record in one call, unless the record
+  // is small enough to start the next buffer
+  if (data.size() < mBufferSize / 2)
+  {
+    VoidResult result = Write({});
+    if (!result.IsSuccess())
+      return result;
+
+    memcpy(mBuffer.get(), data.data(), data.size());
+    mBuffered = data.size();
+    return VoidResult();
+  }
+
+  return Write(data);
+}
+
+VoidResult FileWriter::Flush()
+{
+  return mBuffered ? Write({}) : VoidResult();
+}
+
+VoidResult FileWriter::Sync()
+{
+  VoidResult result = Flush();
+  if (result.IsSuccess() && fdatasync(mFd) != 0)
+    return VoidResult::Failed("Can't sync file '" + mPath + "': " + std::string(strerror(errno)));
+  return result;
+}
+
+uint64_t FileWriter::Size() const
+{
+  return mOffset + mBuffered;
+}
+
+VoidResult FileWriter::Write(std::string_view data)
+{
+  if (!IsOpen())
+    return VoidResult::Failed("File is not open");
+
+  iovec parts[2] = {{mBuffer.get(), mBuffered}, {const_cast<char*>(data.data()), data.size()}};
+  iovec* next = parts;
+  int count = data.empty() ? 1 : 2;
+  size_t total = 0;
+  while (count > 0)
+  {
+    const ssize_t written = pwritev(mFd, next, count, mOffset);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      // Keep only the unwritten part of the buffer, so a later flush continues at mOffset
+      // instead of writing the start again. Part of data may be on disk already.
+      const std::string error = strerror(errno);
+      const size_t fromBuffer = std::min(total, mBuffered);
+      memmove(mBuffer.get(), mBuffer.get() + fromBuffer, mBuffered - fromBuffer);
+      mBuffered -= fromBuffer;
+      return VoidResult::Failed("Can't write file '" + mPath + "': " + error);
+    }
+    mOffset += written;
+    total += written;
+
+    // Short write, continue after the written part
+    size_t left = written;
+    while (count > 0 && left >= next->iov_len)
+    {
+      left -= next->iov_len;
+      ++next;
+      --count;
+    }
+    if (count > 0)
+    {
+      next->iov_base = static_cast<char*>(next->iov_base) + left;
+      next->iov_len -= left;
+    }
+  }
+
+  mBuffered = 0;
+  return VoidResult();
+}
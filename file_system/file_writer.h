@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "result.h"
+
+// Appends many small records to a file through a large buffer. Full buffers are written
+// with a single pwrite, and a record that does not fit is written together with the
+// buffered data in one pwritev, so large records are never copied. Not thread safe.
+class FileWriter
+{
+public:
+  explicit FileWriter(size_t bufferSize = 1024 * 1024);
+  // Flushes, errors are lost, call Close() to see them
+  ~FileWriter();
+
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+
+  // Continues at the end of an existing file unless truncate is set
+  VoidResult Open(const std::string& path, bool truncate = false);
+  VoidResult Close();
+  bool IsOpen() const;
+
+  // On a failed write the part of the buffer that was not written stays buffered, and
+  // Flush() continues with it
+  VoidResult Append(std::string_view data);
+  // Writes the buffer to the file
+  VoidResult Flush();
+  // Flushes and waits until the data is on disk (fdatasync)
+  VoidResult Sync();
+
+  // File size including the buffered data
+  uint64_t Size() const;
+
+private:
+  // Writes the buffer followed by data at mOffset
+  VoidResult Write(std::string_view data);
+
+  std::string mPath;
+  int mFd = -1;
+  // File offset of the first buffered byte
+  uint64_t mOffset = 0;
+  std::unique_ptr<char[]> mBuffer;
+  size_t mBufferSize;
+  size_t mBuffered = 0;
+};
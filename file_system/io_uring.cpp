@@ -0,0 +1,134 @@
+#include "io_uring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+
+template <class T>
+T* At(void* base, uint32_t offset)
+{
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+IoUring::~IoUring()
+{
+  if (mSqes)
+    munmap(mSqes, mSqesSize);
+  if (mCqRing && mCqRing != mSqRing)
+    munmap(mCqRing, mCqRingSize);
+  if (mSqRing)
+    munmap(mSqRing, mSqRingSize);
+  if (mFd >= 0)
+    close(mFd);
+}
+
+VoidResult IoUring::Init(uint32_t entries)
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  mFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (mFd < 0)
+    return VoidResult::Failed("io_uring_setup failed: " + std::string(strerror(errno)));
+
+  // Since 5.4 both rings share one mapping
+  mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMap)
+    mSqRingSize = mCqRingSize = std::max(mSqRingSize, mCqRingSize);
+
+  void* sqRing = mmap(nullptr, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQ_RING);
+  if (sqRing == MAP_FAILED)
+    return VoidResult::Failed("Mapping the io_uring submission queue failed: " + std::string(strerror(errno)));
+  mSqRing = sqRing;
+
+  if (singleMap)
+  {
+    mCqRing = mSqRing;
+  }
+  else
+  {
+    void* cqRing = mmap(nullptr, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_CQ_RING);
+    if (cqRing == MAP_FAILED)
+      return VoidResult::Failed("Mapping the io_uring completion queue failed: " + std::string(strerror(errno)));
+    mCqRing = cqRing;
+  }
+
+  mSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+    return VoidResult::Failed("Mapping the io_uring entries failed: " + std::string(strerror(errno)));
+  mSqes = static_cast<io_uring_sqe*>(sqes);
+
+  mSqHead = At<uint32_t>(mSqRing, params.sq_off.head);
+  mSqTail = At<uint32_t>(mSqRing, params.sq_off.tail);
+  mSqArray = At<uint32_t>(mSqRing, params.sq_off.array);
+  mSqMask = *At<uint32_t>(mSqRing, params.sq_off.ring_mask);
+  mSqEntries = params.sq_entries;
+
+  mCqHead = At<uint32_t>(mCqRing, params.cq_off.head);
+  mCqTail = At<uint32_t>(mCqRing, params.cq_off.tail);
+  mCqes = At<io_uring_cqe>(mCqRing, params.cq_off.cqes);
+  mCqMask = *At<uint32_t>(mCqRing, params.cq_off.ring_mask);
+
+  // Supported operations, kernels before 5.6 can not be probed and are treated as supporting none
+  const size_t probeSize = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+  std::unique_ptr<char[]> probeBuffer(new char[probeSize]());
+  auto* probe = reinterpret_cast<io_uring_probe*>(probeBuffer.get());
+  if (syscall(__NR_io_uring_register, mFd, IORING_REGISTER_PROBE, probe, 256) == 0)
+  {
+    for (uint32_t i = 0; i < probe->ops_len; ++i)
+    {
+      if (probe->ops[i].flags & IO_URING_OP_SUPPORTED)
+        mSupported.set(probe->ops[i].op);
+    }
+  }
+
+  return VoidResult();
+}
+
+bool IoUring::Supports(uint8_t opcode) const
+{
+  return mSupported.test(opcode);
+}
+
+io_uring_sqe* IoUring::GetSqe()
+{
+  const uint32_t tail = *mSqTail;
+  if (tail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE) >= mSqEntries)
+    return nullptr;
+
+  const uint32_t index = tail & mSqMask;
+  io_uring_sqe* sqe = &mSqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  mSqArray[index] = index;
+  // Without SQPOLL the kernel only reads the queue during io_uring_enter, so the entry can
+  // be published before the caller fills it in
+  __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+  return sqe;
+}
+
+VoidResult IoUring::Submit(uint32_t waitFor)
+{
+  for (;;)
+  {
+    const uint32_t pending = *mSqTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE);
+    const unsigned flags = waitFor ? IORING_ENTER_GETEVENTS : 0;
+    if (syscall(__NR_io_uring_enter, mFd, pending, waitFor, flags, nullptr, 0) >= 0)
+      return VoidResult();
+
+    // Interrupted while waiting
+    if (errno == EINTR)
+      continue;
+    return VoidResult::Failed("io_uring_enter failed: " + std::string(strerror(errno)));
+  }
+}
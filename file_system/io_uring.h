@@ -0,0 +1,69 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <stdint.h>
+
+#include <bitset>
+
+#include "result.h"
+
+// Submission and completion queues of an io_uring instance, set up with the raw system
+// calls. Not thread safe, meant to be driven by a single thread.
+class IoUring
+{
+public:
+  IoUring() = default;
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  // Fails when the kernel has no io_uring or it is disabled (io_uring_disabled, seccomp)
+  VoidResult Init(uint32_t entries);
+
+  // False if the running kernel does not know the operation
+  bool Supports(uint8_t opcode) const;
+
+  // Zeroed entry to fill in, queued with the next Submit(). nullptr when the queue is full.
+  io_uring_sqe* GetSqe();
+
+  // Submits the queued entries and waits until at least waitFor completions are available
+  VoidResult Submit(uint32_t waitFor);
+
+  // Calls onCompletion(user_data, res) for every available completion
+  template <class F>
+  void ForEachCompletion(F&& onCompletion)
+  {
+    uint32_t head = *mCqHead;
+    const uint32_t tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+      const io_uring_cqe& cqe = mCqes[head & mCqMask];
+      onCompletion(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+  }
+
+private:
+  int mFd = -1;
+
+  void* mSqRing = nullptr;
+  size_t mSqRingSize = 0;
+  void* mCqRing = nullptr;
+  size_t mCqRingSize = 0;
+  io_uring_sqe* mSqes = nullptr;
+  size_t mSqesSize = 0;
+
+  uint32_t* mSqHead = nullptr;
+  uint32_t* mSqTail = nullptr;
+  uint32_t* mSqArray = nullptr;
+  uint32_t mSqMask = 0;
+  uint32_t mSqEntries = 0;
+
+  uint32_t* mCqHead = nullptr;
+  uint32_t* mCqTail = nullptr;
+  io_uring_cqe* mCqes = nullptr;
+  uint32_t mCqMask = 0;
+
+  std::bitset<256> mSupported;
+};
@@ -0,0 +1,221 @@
+#include "line_reader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "simd_scan.h"
+
+namespace
+{
+
+// Chunks in flight with read-ahead, one being processed and one being read
+constexpr size_t READ_AHEAD_BLOCKS = 2;
+
+}  // namespace
+
+LineReader::LineReader(const LineReaderOptions& options)
+    : mOptions(options)
+{
+  if (mOptions.bufferSize == 0)
+    mOptions.bufferSize = 1;
+}
+
+LineReader::~LineReader()
+{
+  Close();
+}
+
+VoidResult LineReader::Open(const std::string& path)
+{
+  Close();
+
+  // Reset first, so a failed open leaves no lines of the previous file behind
+  mPath = path;
+  mCurrent = Block();
+  mPos = 0;
+  mCarry.clear();
+  mCarryReturned = false;
+  mLineNumber = 0;
+  mError.clear();
+  mFilled.clear();
+  mFree.clear();
+  mEndOfFile = false;
+  mStopping = false;
+
+  do
+  {
+    mFd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  } while (mFd < 0 && errno == EINTR);
+  if (mFd < 0)
+    return VoidResult::Failed("Opening file '" + path + "' failed: " + std::string(strerror(errno)));
+
+  posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  if (mOptions.readAhead)
+  {
+    for (size_t i = 0; i < READ_AHEAD_BLOCKS; ++i)
+      mFree.push_back({std::unique_ptr<char[]>(new char[mOptions.bufferSize]), 0});
+    mThread = std::thread([this]() { ReadAhead(); });
+  }
+  else
+  {
+    mCurrent.data.reset(new char[mOptions.bufferSize]);
+  }
+
+  return VoidResult();
+}
+
+void LineReader::Close()
+{
+  StopReadAhead();
+  if (mFd >= 0)
+  {
+    close(mFd);
+    mFd = -1;
+  }
+}
+
+bool LineReader::Next(std::string_view& line)
+{
+  if (mCarryReturned)
+  {
+    mCarry.clear();
+    mCarryReturned = false;
+  }
+
+  for (;;)
+  {
+    const char* begin = mCurrent.data.get() + mPos;
+    const char* end = mCurrent.data.get() + mCurrent.size;
+    const char* hit = FindChar(begin, end, mOptions.delimiter);
+    if (hit != end)
+    {
+      mPos = hit + 1 - mCurrent.data.get();
+      ++mLineNumber;
+
+      // Only lines spanning chunks are copied
+      if (mCarry.empty())
+      {
+        line = std::string_view(begin, hit - begin);
+      }
+      else
+      {
+        mCarry.append(begin, hit);
+        line = mCarry;
+        mCarryReturned = true;
+      }
+      return true;
+    }
+
+    mCarry.append(begin, end);
+    if (!NextBlock())
+    {
+      if (mCarry.empty() || !mError.empty())
+        return false;
+
+      ++mLineNumber;
+      line = mCarry;
+      mCarryReturned = true;
+      return true;
+    }
+  }
+}
+
+uint64_t LineReader::LineNumber() const
+{
+  return mLineNumber;
+}
+
+VoidResult LineReader::Error() const
+{
+  return mError.empty() ? VoidResult() : VoidResult::Failed(mError);
+}
+
+bool LineReader::NextBlock()
+{
+  mPos = 0;
+  if (mFd < 0)
+  {
+    mCurrent.size = 0;
+    return false;
+  }
+
+  if (!mThread.joinable())
+    return ReadBlock(mCurrent);
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  if (mCurrent.data)
+  {
+    mCurrent.size = 0;
+    mFree.push_back(std::move(mCurrent));
+    mCondition.notify_all();
+  }
+
+  mCondition.wait(lock, [this]() { return !mFilled.empty() || mEndOfFile; });
+  if (mFilled.empty())
+  {
+    mCurrent = Block();
+    return false;
+  }
+
+  mCurrent = std::move(mFilled.front());
+  mFilled.pop_front();
+  return true;
+}
+
+bool LineReader::ReadBlock(Block& block)
+{
+  for (;;)
+  {
+    const ssize_t count = read(mFd, block.data.get(), mOptions.bufferSize);
+    if (count < 0 && errno == EINTR)
+      continue;
+
+    if (count < 0)
+      mError = "Can't read the file '" + mPath + "': " + std::string(strerror(errno));
+    block.size = count > 0 ? count : 0;
+    return count > 0;
+  }
+}
+
+void LineReader::ReadAhead()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  for (;;)
+  {
+    mCondition.wait(lock, [this]() { return !mFree.empty() || mStopping; });
+    if (mStopping)
+      return;
+
+    Block block = std::move(mFree.back());
+    mFree.pop_back();
+    lock.unlock();
+
+    const bool read = ReadBlock(block);
+
+    lock.lock();
+    if (!read)
+    {
+      mEndOfFile = true;
+      mCondition.notify_all();
+      return;
+    }
+    mFilled.push_back(std::move(block));
+    mCondition.notify_all();
+  }
+}
+
+void LineReader::StopReadAhead()
+{
+  if (!mThread.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+    mCondition.notify_all();
+  }
+  mThread.join();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "result.h"
+
+struct LineReaderOptions
+{
+  char delimiter = '\n';
+  // The file is read in chunks of this size, memory use stays constant apart from lines
+  // longer than a chunk
+  size_t bufferSize = 1024 * 1024;
+  // Read the next chunk on a background thread while the current one is processed
+  bool readAhead = false;
+};
+
+// Streams the lines of a file without loading it:
+//   LineReader reader;
+//   if (!reader.Open(path)) ...
+//   for (std::string_view line; reader.Next(line);) ...
+//   if (!reader.Error()) ...
+// Lines are views into the reader and only valid until the next call to Next().
+class LineReader
+{
+public:
+  explicit LineReader(const LineReaderOptions& options = LineReaderOptions());
+  ~LineReader();
+
+  LineReader(const LineReader&) = delete;
+  LineReader& operator=(const LineReader&) = delete;
+
+  VoidResult Open(const std::string& path);
+  void Close();
+
+  // Sets line to the next line without its delimiter. A last line without a delimiter is
+  // returned as well. False at the end of the file or once reading failed.
+  bool Next(std::string_view& line);
+
+  // Number of lines returned so far
+  uint64_t LineNumber() const;
+  // Failure of the last read, if any
+  VoidResult Error() const;
+
+private:
+  struct Block
+  {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+  };
+
+  // Makes the next chunk current, false at the end of the file or on an error
+  bool NextBlock();
+  // Reads one chunk into block, sets mError on failure
+  bool ReadBlock(Block& block);
+  void ReadAhead();
+  void StopReadAhead();
+
+  LineReaderOptions mOptions;
+  std::string mPath;
+  int mFd = -1;
+
+  Block mCurrent;
+  size_t mPos = 0;
+  // Start of a line spanning several chunks
+  std::string mCarry;
+  // mCarry was returned by the last call and has to be cleared first
+  bool mCarryReturned = false;
+  uint64_t mLineNumber = 0;
+  std::string mError;
+
+  // Read-ahead thread, fills free blocks and queues them in file order
+  std::thread mThread;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::deque<Block> mFilled;
+  std::vector<Block> mFree;
+  bool mEndOfFile = false;
+  bool mStopping = false;
+};
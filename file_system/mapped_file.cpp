@@ -0,0 +1,157 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+struct MappedFile::Content
+{
+  ~Content()
+  {
+    if (mapped)
+      munmap(const_cast<char*>(data), size);
+  }
+
+  const char* data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  // Holds the content when it was read instead of mapped
+  std::string buffer;
+};
+
+namespace
+{
+
+int ToAdvice(MappedFile::Access access)
+{
+  switch (access)
+  {
+    case MappedFile::Access::Sequential:
+      return MADV_SEQUENTIAL;
+    case MappedFile::Access::Random:
+      return MADV_RANDOM;
+    case MappedFile::Access::WillNeed:
+      return MADV_WILLNEED;
+    default:
+      return MADV_NORMAL;
+  }
+}
+
+// Reads until EOF, sizeHint is the expected size (0 if unknown, e.g. for /proc files)
+bool ReadAll(int fd, size_t sizeHint, std::string& buffer)
+{
+  // One byte more than expected, so a file of the expected size is read in one call
+  // and only the EOF check needs a second one
+  buffer.resize(sizeHint ? sizeHint + 1 : 4096);
+  size_t used = 0;
+  for (;;)
+  {
+    if (used == buffer.size())
+      buffer.resize(buffer.size() * 2);
+
+    const ssize_t count = read(fd, &buffer[used], buffer.size() - used);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (count == 0)
+      break;
+    used += count;
+  }
+  buffer.resize(used);
+  return true;
+}
+
+}  // namespace
+
+MappedFile::MappedFile(std::shared_ptr<const Content> content)
+    : mContent(std::move(content))
+{
+}
+
+Result<MappedFile> MappedFile::Open(const std::string& path, Access access)
+{
+  int fd;
+  do
+  {
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0)
+    return Result<MappedFile>::Failed("Opening file '" + path + "' failed: " + std::string(strerror(errno)));
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    const std::string error = strerror(errno);
+    close(fd);
+    return Result<MappedFile>::Failed("Can't stat the file '" + path + "': " + error);
+  }
+
+  auto content = std::make_shared<Content>();
+  const size_t size = static_cast<size_t>(st.st_size);
+  if (S_ISREG(st.st_mode) && size >= MIN_MAP_SIZE)
+  {
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // Some file systems can not be mapped, read those instead
+    if (map != MAP_FAILED)
+    {
+      content->data = static_cast<const char*>(map);
+      content->size = size;
+      content->mapped = true;
+      if (access != Access::Normal)
+        madvise(map, size, ToAdvice(access));
+    }
+  }
+
+  if (!content->mapped)
+  {
+    if (!ReadAll(fd, S_ISREG(st.st_mode) ? size : 0, content->buffer))
+    {
+      const std::string error = strerror(errno);
+      close(fd);
+      return Result<MappedFile>::Failed("Can't read the file '" + path + "': " + error);
+    }
+    content->data = content->buffer.data();
+    content->size = content->buffer.size();
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+  return Result<MappedFile>(MappedFile(std::move(content)));
+}
+
+std::string_view MappedFile::View() const
+{
+  return mContent ? std::string_view(mContent->data, mContent->size) : std::string_view();
+}
+
+const char* MappedFile::Data() const
+{
+  return mContent ? mContent->data : nullptr;
+}
+
+size_t MappedFile::Size() const
+{
+  return mContent ? mContent->size : 0;
+}
+
+bool MappedFile::IsEmpty() const
+{
+  return Size() == 0;
+}
+
+bool MappedFile::IsMapped() const
+{
+  return mContent && mContent->mapped;
+}
+
+void MappedFile::Advise(Access access) const
+{
+  if (IsMapped())
+    madvise(const_cast<char*>(mContent->data), mContent->size, ToAdvice(access));
+}
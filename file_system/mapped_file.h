@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "result.h"
+
+// Read-only view of a whole file. Large regular files are mmap'ed so loading costs no
+// copy and pages are only read when touched, small or special files (pipes, /proc) are
+// read into memory with as few read calls as possible. Copies share the same mapping,
+// which is released with the last of them. The content must not be changed by another
+// process while mapped.
+class MappedFile
+{
+public:
+  // Expected access pattern, passed to the kernel through madvise
+  enum class Access
+  {
+    Normal,
+    // Aggressive read-ahead, pages behind are dropped early
+    Sequential,
+    // No read-ahead
+    Random,
+    // Start reading the whole file in the background now
+    WillNeed
+  };
+
+  // Files below this size are read rather than mapped
+  static constexpr size_t MIN_MAP_SIZE = 64 * 1024;
+
+  // Empty file
+  MappedFile() = default;
+
+  static Result<MappedFile> Open(const std::string& path, Access access = Access::Normal);
+
+  std::string_view View() const;
+  const char* Data() const;
+  size_t Size() const;
+  bool IsEmpty() const;
+  // False when the content was read into memory
+  bool IsMapped() const;
+
+  // Changes the hint for the whole file, e.g. Random once a sequential index pass is done.
+  // Does nothing for files that were read.
+  void Advise(Access access) const;
+
+private:
+  struct Content;
+
+  explicit MappedFile(std::shared_ptr<const Content> content);
+
+  std::shared_ptr<const Content> mContent;
+};
@@ -6,10 +6,11 @@
 #include <array>
 
 #include "logging.h"
+#include "string_builder.h"
 
 int SyncProcess::Execute(const std::string& cmd, std::string& result)
 {
-  std::array<char, 128> buffer;
+  std::array<char, 4096> buffer;
 
   FILE* p = popen(cmd.c_str(), "r");
   if (!p)
@@ -18,22 +19,21 @@ int SyncProcess::Execute(const std::string& cmd, std::string& result)
     return -errno;
   }
 
-  result.clear();
-  while (!feof(p))
+  // Collect the output in a builder and copy it into result once at the end
+  StringBuilder output;
+  size_t read;
+  while ((read = fread(buffer.data(), 1, buffer.size(), p)) > 0)
   {
-    // nullptr can also occur on newline, so continue
-    if (fgets(buffer.data(), 128, p) != nullptr)
+    try
     {
-      try
-      {
-        result += buffer.data();
-      }
-      catch (std::exception& e)
-      {
-        LOG_ERROR("Exception when updating buffer for cmd");
-      }
+      output.Append(std::string_view(buffer.data(), read));
+    }
+    catch (std::exception& e)
+    {
+      LOG_ERROR("Exception when updating buffer for cmd");
     }
   }
+  result = output.Release();
 
   int ret = pclose(p);
   if (ret < 0)
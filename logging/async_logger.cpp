@@ -0,0 +1,178 @@
+#include "async_logger.h"
+
+#include <chrono>
+
+namespace logging
+{
+
+// How long the writer sleeps when the queue is empty before checking again
+static constexpr std::chrono::milliseconds WRITER_IDLE_WAIT(50);
+
+AsyncLogger& AsyncLogger::Instance()
+{
+  static AsyncLogger instance;
+  return instance;
+}
+
+AsyncLogger::~AsyncLogger()
+{
+  Stop();
+}
+
+void AsyncLogger::Start(size_t capacity, OverflowPolicy policy)
+{
+  std::lock_guard<std::mutex> lock(mControlMutex);
+  if (mWriter.joinable())
+    return;
+
+  mQueue = std::make_unique<RingBuffer<LogRecord>>(capacity);
+  mPolicy = policy;
+  mStopping = false;
+  mWriterActive = true;
+  mWriter = std::thread(&AsyncLogger::Run, this);
+  mAccepting = true;
+}
+
+void AsyncLogger::Stop()
+{
+  std::lock_guard<std::mutex> lock(mControlMutex);
+  if (!mWriter.joinable())
+    return;
+
+  // Stop accepting and wait for producers that already passed the check
+  mAccepting = false;
+  while (mInFlight.load() != 0)
+    std::this_thread::yield();
+
+  // The writer drains whatever is left before exiting
+  mStopping = true;
+  WakeWriter();
+  mWriter.join();
+  mQueue.reset();
+}
+
+void AsyncLogger::Flush()
+{
+  if (!mWriterActive.load())
+    return;
+
+  const uint64_t target = mEnqueued.load();
+  WakeWriter();
+
+  std::unique_lock<std::mutex> lock(mFlushMutex);
+  mFlushCv.wait(lock, [this, target] { return mProcessed.load() >= target || !mWriterActive.load(); });
+}
+
+bool AsyncLogger::TryLog(LogRecord&& record)
+{
+  mInFlight.fetch_add(1);
+  if (!mAccepting.load())
+  {
+    mInFlight.fetch_sub(1);
+    return false;
+  }
+
+  // Counted before the push, so a Flush() that reads mEnqueued waits for it even if
+  // the writer picks it up before this thread continues. Records that end up dropped
+  // are counted as processed.
+  mEnqueued.fetch_add(1);
+
+  bool pushed = mQueue->TryPush(std::move(record));
+  while (!pushed)
+  {
+    if (mPolicy == OverflowPolicy::DropNewest)
+    {
+      mDropped.fetch_add(1, std::memory_order_relaxed);
+      MarkProcessed(1);
+      break;
+    }
+
+    if (mPolicy == OverflowPolicy::DropOldest)
+    {
+      LogRecord oldest;
+      if (mQueue->TryPop(oldest))
+      {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        MarkProcessed(1);
+      }
+    }
+    else
+    {
+      // Block: give the writer a chance to catch up
+      WakeWriter();
+      std::this_thread::yield();
+    }
+
+    pushed = mQueue->TryPush(std::move(record));
+  }
+
+  if (pushed && mWriterWaiting.load())
+    WakeWriter();
+
+  mInFlight.fetch_sub(1);
+  return true;
+}
+
+bool AsyncLogger::IsRunning() const
+{
+  return mAccepting.load();
+}
+
+uint64_t AsyncLogger::Dropped() const
+{
+  return mDropped.load(std::memory_order_relaxed);
+}
+
+void AsyncLogger::Run()
+{
+  LogRecord record;
+  for (;;)
+  {
+    uint64_t processed = 0;
+    while (mQueue->TryPop(record))
+    {
+      Dispatch(record);
+      ++processed;
+    }
+
+    if (processed)
+    {
+      MarkProcessed(processed);
+      continue;
+    }
+
+    if (mStopping.load())
+      break;
+
+    {
+      std::unique_lock<std::mutex> lock(mWakeMutex);
+      mWriterWaiting = true;
+      if (mQueue->IsEmpty() && !mStopping.load())
+        mWakeCv.wait_for(lock, WRITER_IDLE_WAIT);
+      mWriterWaiting = false;
+    }
+    TickOutputs();
+  }
+
+  FlushOutputs();
+
+  std::lock_guard<std::mutex> lock(mFlushMutex);
+  mWriterActive = false;
+  mFlushCv.notify_all();
+}
+
+void AsyncLogger::WakeWriter()
+{
+  std::lock_guard<std::mutex> lock(mWakeMutex);
+  mWakeCv.notify_one();
+}
+
+void AsyncLogger::MarkProcessed(uint64_t count)
+{
+  mProcessed.fetch_add(count);
+
+  std::lock_guard<std::mutex> lock(mFlushMutex);
+  mFlushCv.notify_all();
+}
+
+}  // namespace logging
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "logging.h"
+#include "ring_buffer.h"
+
+namespace logging
+{
+
+// Moves records from the producer threads to a single writer thread
+// through a bounded RingBuffer. Only the writer thread calls Dispatch,
+// so producers never block on terminal or file I/O.
+class AsyncLogger
+{
+public:
+  static AsyncLogger& Instance();
+
+  ~AsyncLogger();
+
+  void Start(size_t capacity, OverflowPolicy policy);
+  void Stop();
+  void Flush();
+
+  // Returns false when async mode is off and the caller must write the record itself
+  bool TryLog(LogRecord&& record);
+
+  bool IsRunning() const;
+  uint64_t Dropped() const;
+
+private:
+  AsyncLogger() = default;
+
+  void Run();
+  void WakeWriter();
+  void MarkProcessed(uint64_t count);
+
+  std::unique_ptr<RingBuffer<LogRecord>> mQueue;
+  OverflowPolicy mPolicy = OverflowPolicy::Block;
+  std::thread mWriter;
+
+  std::atomic<bool> mAccepting = false;
+  std::atomic<bool> mStopping = false;
+  std::atomic<bool> mWriterActive = false;
+  std::atomic<bool> mWriterWaiting = false;
+  std::atomic<uint32_t> mInFlight = 0;
+
+  std::atomic<uint64_t> mEnqueued = 0;
+  std::atomic<uint64_t> mProcessed = 0;
+  std::atomic<uint64_t> mDropped = 0;
+
+  // Serializes Start/Stop
+  std::mutex mControlMutex;
+
+  std::mutex mWakeMutex;
+  std::condition_variable mWakeCv;
+
+  std::mutex mFlushMutex;
+  std::condition_variable mFlushCv;
+};
+
+}  // namespace logging
@@ -0,0 +1,826 @@
+#include "crash_ring.h"
+
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace logging
+{
+
+std::atomic<int> gCrashRingLevel = -1;
+
+namespace
+{
+
+constexpr size_t MAX_RINGS = 256;
+constexpr size_t FILENAME_SIZE = 32;
+constexpr size_t ENTRY_DATA_SIZE = 192;
+
+struct CrashRecord
+{
+  int64_t timestampUs;
+  LogLevel level;
+  uint32_t line;
+  // Null when data holds the message text instead of captured arguments
+  const char* format;
+  uint16_t size;
+  char filename[FILENAME_SIZE];
+  uint8_t data[ENTRY_DATA_SIZE];
+};
+
+// Written by the owning thread only, read like a seqlock: a dump copies the record and
+// keeps the copy only if the sequence did not change meanwhile
+struct CrashEntry
+{
+  // Record number + 1, 0 while empty or being written
+  std::atomic<uint64_t> sequence = 0;
+  CrashRecord record;
+};
+
+struct CrashRing
+{
+  explicit CrashRing(size_t capacity)
+      : capacity(capacity)
+      , entries(new CrashEntry[capacity])
+  {
+  }
+
+  std::atomic<bool> inUse = true;
+  std::atomic<uint64_t> next = 0;
+  long threadId = 0;
+  const size_t capacity;
+  std::unique_ptr<CrashEntry[]> entries;
+};
+
+// Rings are never freed, only handed over to new threads, so a dump can walk
+// them at any time without locking
+std::atomic<CrashRing*> gRings[MAX_RINGS];
+std::atomic<size_t> gEntriesPerThread = 256;
+// Local time offset, taken when the ring is enabled since localtime_r is not safe in a signal handler
+std::atomic<long> gUtcOffsetSeconds = 0;
+
+// Plain level letters, LevelPrefix() is not usable from a signal handler
+constexpr char LEVEL_CHARS[] = {'E', 'W', 'I', 'D', 'T'};
+
+// Gives the ring back when the owning thread exits
+struct RingHandle
+{
+  CrashRing* ring = nullptr;
+
+  ~RingHandle()
+  {
+    if (ring)
+      ring->inUse = false;
+  }
+};
+
+thread_local RingHandle tRing;
+
+long CurrentThreadId()
+{
+#if defined(SYS_gettid)
+  return static_cast<long>(syscall(SYS_gettid));
+#else
+  return static_cast<long>(getpid());
+#endif
+}
+
+void ResetRing(CrashRing* ring)
+{
+  for (size_t i = 0; i < ring->capacity; ++i)
+    ring->entries[i].sequence.store(0, std::memory_order_relaxed);
+
+  ring->next.store(0, std::memory_order_relaxed);
+  ring->threadId = CurrentThreadId();
+}
+
+CrashRing* AcquireRing()
+{
+  if (tRing.ring)
+    return tRing.ring;
+
+  // Take over the ring of a thread that exited
+  for (auto& slot : gRings)
+  {
+    CrashRing* ring = slot.load();
+    bool released = false;
+    if (ring && ring->inUse.compare_exchange_strong(released, true))
+    {
+      ResetRing(ring);
+      tRing.ring = ring;
+      return ring;
+    }
+  }
+
+  auto* ring = new CrashRing(std::max<size_t>(gEntriesPerThread.load(), 1));
+  ResetRing(ring);
+  for (auto& slot : gRings)
+  {
+    CrashRing* empty = nullptr;
+    if (slot.compare_exchange_strong(empty, ring))
+    {
+      tRing.ring = ring;
+      return ring;
+    }
+  }
+
+  // Too many threads, this one goes without history
+  delete ring;
+  return nullptr;
+}
+
+void CopyFilename(char* dst, std::string_view filename)
+{
+  const size_t len = std::min(filename.size(), FILENAME_SIZE - 1);
+  memcpy(dst, filename.data(), len);
+  dst[len] = '\0';
+}
+
+void WriteAll(int fd, const char* data, size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t written = write(fd, data, size);
+    if (written <= 0)
+      return;
+
+    data += written;
+    size -= written;
+  }
+}
+
+void CacheUtcOffset()
+{
+  const std::time_t now = std::time(nullptr);
+  gUtcOffsetSeconds = ToLocalTm(now).tm_gmtoff;
+}
+
+// Days since 1970-01-01 to year, month and day, without the locks of localtime_r
+void CivilFromDays(int64_t days, int& year, int& month, int& day)
+{
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const int64_t dayOfEra = days - era * 146097;
+  const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  const int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+  day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+  month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+  year = static_cast<int>(yearOfEra + era * 400 + (month <= 2));
+}
+
+// Text in a fixed buffer, built without snprintf which may take locale locks or
+// allocate and so is not safe in a signal handler. Output past the end is dropped.
+template <size_t N>
+class SafeText
+{
+public:
+  void Append(char c)
+  {
+    if (mLength < N)
+      mText[mLength++] = c;
+  }
+
+  void Append(std::string_view text)
+  {
+    const size_t size = std::min(text.size(), N - mLength);
+    if (size == 0)
+      return;
+    memcpy(mText + mLength, text.data(), size);
+    mLength += size;
+  }
+
+  void Pad(size_t count, char c)
+  {
+    for (; count > 0; --count)
+      Append(c);
+  }
+
+  // At least minDigits digits, zero padded
+  void AppendUnsigned(uint64_t value, unsigned base = 10, size_t minDigits = 1, bool upper = false)
+  {
+    const char* digitChars = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char digits[64];
+    size_t count = 0;
+    do
+    {
+      digits[count++] = digitChars[value % base];
+      value /= base;
+    } while (value > 0);
+
+    Pad(minDigits > count ? minDigits - count : 0, '0');
+    while (count > 0)
+      Append(digits[--count]);
+  }
+
+  std::string_view View() const
+  {
+    return std::string_view(mText, mLength);
+  }
+
+  size_t Size() const
+  {
+    return mLength;
+  }
+
+private:
+  char mText[N];
+  size_t mLength = 0;
+};
+
+using DumpLine = SafeText<1024>;
+using NumberText = SafeText<96>;
+
+// Decimal exponent of value (> 0) once rounded to digits significant digits, value is
+// scaled to [1, 10)
+int NormalizeDecimal(double& value, int digits)
+{
+  int exponent = 0;
+  while (value >= 10)
+  {
+    value /= 10;
+    ++exponent;
+  }
+  while (value < 1)
+  {
+    value *= 10;
+    --exponent;
+  }
+
+  double half = 0.5;
+  for (int i = 1; i < digits; ++i)
+    half /= 10;
+  if (value + half >= 10)
+  {
+    value /= 10;
+    ++exponent;
+  }
+  return exponent;
+}
+
+// value >= 0 and below 2^64, rounded to precision decimals
+void AppendFixed(NumberText& out, double value, int precision)
+{
+  double half = 0.5;
+  for (int i = 0; i < precision; ++i)
+    half /= 10;
+  value += half;
+
+  const uint64_t integer = static_cast<uint64_t>(value);
+  double fraction = value - static_cast<double>(integer);
+  out.AppendUnsigned(integer);
+  if (precision > 0)
+    out.Append('.');
+  for (int i = 0; i < precision; ++i)
+  {
+    fraction *= 10;
+    const int digit = std::min(static_cast<int>(fraction), 9);
+    out.Append(static_cast<char>('0' + digit));
+    fraction -= digit;
+  }
+}
+
+// value > 0, mantissa rounded to precision decimals
+void AppendExponent(NumberText& out, double value, int precision, bool upper)
+{
+  const int exponent = NormalizeDecimal(value, precision + 1);
+  AppendFixed(out, std::min(value, 9.999999999999999), precision);
+  out.Append(upper ? 'E' : 'e');
+  out.Append(exponent < 0 ? '-' : '+');
+  out.AppendUnsigned(static_cast<uint64_t>(exponent < 0 ? -exponent : exponent), 10, 2);
+}
+
+// Drops the trailing zeros of the fraction (and the '.') of %g output
+void TrimFraction(NumberText& out, NumberText& trimmed)
+{
+  std::string_view text = out.View();
+  const size_t exponentPos = text.find_first_of("eE");
+  std::string_view mantissa = text.substr(0, exponentPos);
+  if (mantissa.find('.') != std::string_view::npos)
+  {
+    while (mantissa.back() == '0')
+      mantissa.remove_suffix(1);
+    if (mantissa.back() == '.')
+      mantissa.remove_suffix(1);
+  }
+  trimmed.Append(mantissa);
+  if (exponentPos != std::string_view::npos)
+    trimmed.Append(text.substr(exponentPos));
+}
+
+// %e, %f and %g of the magnitude of value. %a is printed like %e. Fixed output of values
+// beyond 2^64 switches to the exponent form.
+void AppendDouble(NumberText& out, double value, char conversion, int precision, bool alternate)
+{
+  const bool upper = conversion >= 'A' && conversion <= 'Z';
+  if (std::isnan(value))
+    return out.Append(upper ? "NAN" : "nan");
+  if (std::isinf(value))
+    return out.Append(upper ? "INF" : "inf");
+
+  precision = std::min(precision < 0 ? 6 : precision, 17);
+  value = std::fabs(value);
+  switch (conversion)
+  {
+    case 'f':
+    case 'F':
+      if (value < 1.8e19)
+        AppendFixed(out, value, precision);
+      else
+        AppendExponent(out, value, precision, upper);
+      break;
+    case 'g':
+    case 'G':
+    {
+      const int digits = std::max(precision, 1);
+      double scaled = value;
+      const int exponent = value == 0 ? 0 : NormalizeDecimal(scaled, digits);
+      NumberText full;
+      if (exponent < -4 || exponent >= digits)
+        AppendExponent(full, value, digits - 1, upper);
+      else
+        AppendFixed(full, value, digits - 1 - exponent);
+      if (alternate)
+        out.Append(full.View());
+      else
+        TrimFraction(full, out);
+      break;
+    }
+    default:
+      if (value == 0)
+      {
+        AppendFixed(out, 0, precision);
+        out.Append(upper ? "E+00" : "e+00");
+      }
+      else
+      {
+        AppendExponent(out, value, precision, upper);
+      }
+      break;
+  }
+}
+
+// Parsed conversion spec
+struct SafeSpec
+{
+  bool left = false;
+  bool zero = false;
+  bool alternate = false;
+  char sign = 0;
+  size_t width = 0;
+  int precision = -1;
+};
+
+// Writes text padded to the spec's width. prefix (sign, "0x") goes before zero padding.
+void AppendPadded(DumpLine& out, const SafeSpec& spec, std::string_view prefix, std::string_view text, bool numeric)
+{
+  const size_t size = prefix.size() + text.size();
+  const size_t padding = spec.width > size ? spec.width - size : 0;
+  if (spec.left)
+  {
+    out.Append(prefix);
+    out.Append(text);
+    out.Pad(padding, ' ');
+  }
+  else if (spec.zero && numeric)
+  {
+    out.Append(prefix);
+    out.Pad(padding, '0');
+    out.Append(text);
+  }
+  else
+  {
+    out.Pad(padding, ' ');
+    out.Append(prefix);
+    out.Append(text);
+  }
+}
+
+int64_t SafeAsInt(const FormatArg& arg)
+{
+  switch (arg.type)
+  {
+    case FormatArgType::UInt:
+      return static_cast<int64_t>(arg.u);
+    case FormatArgType::Double:
+      return static_cast<int64_t>(arg.d);
+    case FormatArgType::Pointer:
+      return static_cast<int64_t>(reinterpret_cast<uintptr_t>(arg.p));
+    default:
+      return arg.i;
+  }
+}
+
+double SafeAsDouble(const FormatArg& arg)
+{
+  switch (arg.type)
+  {
+    case FormatArgType::Int:
+      return static_cast<double>(arg.i);
+    case FormatArgType::UInt:
+      return static_cast<double>(arg.u);
+    default:
+      return arg.d;
+  }
+}
+
+void AppendSafeString(DumpLine& out, const SafeSpec& spec, std::string_view value)
+{
+  if (spec.precision >= 0)
+    value = value.substr(0, static_cast<size_t>(spec.precision));
+  AppendPadded(out, spec, {}, value, false);
+}
+
+void AppendSafeInteger(DumpLine& out, const SafeSpec& spec, bool negative, uint64_t magnitude, unsigned base,
+                       bool upper, std::string_view prefix)
+{
+  NumberText digits;
+  // Like printf, a precision of 0 prints nothing for 0
+  if (magnitude != 0 || spec.precision != 0)
+    digits.AppendUnsigned(magnitude, base, spec.precision > 0 ? spec.precision : 1, upper);
+
+  const char sign = negative ? '-' : spec.sign;
+  NumberText fullPrefix;
+  if (sign)
+    fullPrefix.Append(sign);
+  fullPrefix.Append(prefix);
+
+  SafeSpec padded = spec;
+  padded.zero = spec.zero && spec.precision < 0;
+  AppendPadded(out, padded, fullPrefix.View(), digits.View(), true);
+}
+
+void AppendSafePointer(DumpLine& out, const SafeSpec& spec, const void* value)
+{
+  if (!value)
+    return AppendPadded(out, spec, {}, "(nil)", false);
+
+  NumberText digits;
+  digits.AppendUnsigned(reinterpret_cast<uintptr_t>(value), 16);
+  AppendPadded(out, spec, "0x", digits.View(), true);
+}
+
+void AppendSafeArg(DumpLine& out, const SafeSpec& spec, char conversion, const FormatArg& arg)
+{
+  switch (conversion)
+  {
+    case 'd':
+    case 'i':
+    {
+      if (arg.type == FormatArgType::String)
+        return AppendSafeString(out, spec, arg.s);
+      if (arg.type == FormatArgType::UInt)
+        return AppendSafeInteger(out, spec, false, arg.u, 10, false, {});
+
+      const int64_t value = SafeAsInt(arg);
+      const uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+      return AppendSafeInteger(out, spec, value < 0, magnitude, 10, false, {});
+    }
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+    {
+      if (arg.type == FormatArgType::String)
+        return AppendSafeString(out, spec, arg.s);
+
+      const uint64_t value = static_cast<uint64_t>(SafeAsInt(arg));
+      SafeSpec unsignedSpec = spec;
+      unsignedSpec.sign = 0;
+      const unsigned base = conversion == 'o' ? 8 : conversion == 'u' ? 10 : 16;
+      std::string_view prefix;
+      if (spec.alternate && value != 0 && base == 16)
+        prefix = conversion == 'X' ? "0X" : "0x";
+      else if (spec.alternate && base == 8)
+        prefix = "0";
+      return AppendSafeInteger(out, unsignedSpec, false, value, base, conversion == 'X', prefix);
+    }
+    case 'c':
+    {
+      const char c = static_cast<char>(SafeAsInt(arg));
+      return AppendPadded(out, spec, {}, std::string_view(&c, 1), false);
+    }
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+    {
+      const double value = SafeAsDouble(arg);
+      NumberText digits;
+      AppendDouble(digits, value, conversion, spec.precision, spec.alternate);
+      const char sign = std::signbit(value) && !std::isnan(value) ? '-' : spec.sign;
+      return AppendPadded(out, spec, std::string_view(&sign, sign ? 1 : 0), digits.View(), std::isfinite(value));
+    }
+    case 's':
+      switch (arg.type)
+      {
+        case FormatArgType::String:
+          return AppendSafeString(out, spec, arg.s);
+        case FormatArgType::Double:
+          return AppendSafeArg(out, spec, 'g', arg);
+        case FormatArgType::UInt:
+          return AppendSafeArg(out, spec, 'u', arg);
+        case FormatArgType::Pointer:
+          return AppendSafePointer(out, spec, arg.p);
+        default:
+          return AppendSafeArg(out, spec, 'd', arg);
+      }
+    case 'p':
+      return AppendSafePointer(out, spec, arg.type == FormatArgType::String ? arg.s.data() : arg.p);
+    default:
+      break;
+  }
+}
+
+int ReadSafeNumber(const char*& p)
+{
+  int value = 0;
+  while (*p >= '0' && *p <= '9')
+  {
+    value = std::min(value * 10 + (*p - '0'), 1 << 20);
+    ++p;
+  }
+  return value;
+}
+
+// Signal safe counterpart of FormatArgsTo for the conversions printf supports
+void AppendSafeFormat(DumpLine& out, const char* format, const FormatArg* args, size_t count)
+{
+  size_t argIndex = 0;
+  auto next = [&]() -> const FormatArg* { return argIndex < count ? &args[argIndex++] : nullptr; };
+
+  const char* p = format;
+  while (*p)
+  {
+    if (*p != '%')
+    {
+      const char* start = p;
+      while (*p && *p != '%')
+        ++p;
+      out.Append(std::string_view(start, p - start));
+      continue;
+    }
+
+    if (p[1] == '%')
+    {
+      out.Append('%');
+      p += 2;
+      continue;
+    }
+
+    const char* start = p++;
+    SafeSpec spec;
+    for (;; ++p)
+    {
+      if (*p == '-')
+        spec.left = true;
+      else if (*p == '0')
+        spec.zero = true;
+      else if (*p == '#')
+        spec.alternate = true;
+      else if (*p == '+')
+        spec.sign = '+';
+      else if (*p == ' ')
+        spec.sign = spec.sign ? spec.sign : ' ';
+      else if (*p != '\'')
+        break;
+    }
+
+    if (*p == '*')
+    {
+      const FormatArg* arg = next();
+      const int64_t width = arg ? SafeAsInt(*arg) : 0;
+      spec.left = spec.left || width < 0;
+      spec.width = static_cast<size_t>(std::min<int64_t>(width < 0 ? -width : width, 1 << 20));
+      ++p;
+    }
+    else
+    {
+      spec.width = static_cast<size_t>(ReadSafeNumber(p));
+    }
+
+    if (*p == '.')
+    {
+      ++p;
+      if (*p == '*')
+      {
+        const FormatArg* arg = next();
+        const int64_t precision = arg ? SafeAsInt(*arg) : 0;
+        spec.precision = precision < 0 ? -1 : static_cast<int>(std::min<int64_t>(precision, 1 << 20));
+        ++p;
+      }
+      else
+      {
+        spec.precision = ReadSafeNumber(p);
+      }
+    }
+
+    while (*p && strchr("hlLqjzt", *p))
+      ++p;
+
+    const char conversion = *p;
+    if (!conversion)
+    {
+      out.Append(std::string_view(start));
+      break;
+    }
+    ++p;
+
+    const FormatArg* arg = next();
+    if (!arg || !strchr("diouxXceEfFgGaAsp", conversion))
+    {
+      // Missing argument or unknown conversion, keep the spec as text. %n writes nothing.
+      if (conversion != 'n')
+        out.Append(std::string_view(start, p - start));
+      continue;
+    }
+
+    AppendSafeArg(out, spec, conversion, *arg);
+  }
+}
+
+void DumpEntry(int fd, const CrashRecord& entry)
+{
+  DumpLine line;
+
+  const int64_t local = entry.timestampUs / 1000000 + gUtcOffsetSeconds.load(std::memory_order_relaxed);
+  const int64_t days = (local >= 0 ? local : local - 86399) / 86400;
+  const int64_t secondOfDay = local - days * 86400;
+  int year, month, day;
+  CivilFromDays(days, year, month, day);
+
+  // Same layout as FormatLine: "dd/mm/yyyy hh:mm:ss.<micros as 9 digits> [L] file:line: "
+  line.AppendUnsigned(day, 10, 2);
+  line.Append('/');
+  line.AppendUnsigned(month, 10, 2);
+  line.Append('/');
+  line.AppendUnsigned(year, 10, 4);
+  line.Append(' ');
+  line.AppendUnsigned(secondOfDay / 3600, 10, 2);
+  line.Append(':');
+  line.AppendUnsigned(secondOfDay / 60 % 60, 10, 2);
+  line.Append(':');
+  line.AppendUnsigned(secondOfDay % 60, 10, 2);
+  line.Append('.');
+  line.AppendUnsigned(static_cast<uint64_t>(entry.timestampUs % 1000000), 10, 9);
+  line.Append(" [");
+  line.Append(LEVEL_CHARS[std::min(static_cast<size_t>(entry.level), sizeof(LEVEL_CHARS) - 1)]);
+  line.Append("] ");
+  line.Append(std::string_view(entry.filename, strnlen(entry.filename, sizeof(entry.filename))));
+  line.Append(':');
+  line.AppendUnsigned(entry.line);
+  line.Append(": ");
+
+  if (entry.format)
+  {
+    FormatArg args[LogArgs::MAX_STACK_ARGS];
+    size_t count = 0;
+    LogArgs::ForEachArg(entry.data, entry.size, [&args, &count](const FormatArg& arg) {
+      if (count < LogArgs::MAX_STACK_ARGS)
+        args[count++] = arg;
+    });
+    AppendSafeFormat(line, entry.format, args, count);
+  }
+  else
+  {
+    line.Append(std::string_view(reinterpret_cast<const char*>(entry.data), entry.size));
+  }
+
+  // Written apart so a line cut at the buffer size still ends with it
+  WriteAll(fd, line.View().data(), line.Size());
+  WriteAll(fd, "\n", 1);
+}
+
+void CrashSignalHandler(int signal)
+{
+  NumberText header;
+  header.Append("\n*** Fatal signal ");
+  header.AppendUnsigned(static_cast<uint64_t>(signal));
+  header.Append(", recent log history ***\n");
+  WriteAll(STDERR_FILENO, header.View().data(), header.Size());
+
+  DumpCrashRing(STDERR_FILENO);
+
+  // The handler was installed with SA_RESETHAND, so this runs the default action
+  raise(signal);
+}
+
+}  // namespace
+
+void RecordCrashEntry(std::chrono::system_clock::time_point now, LogLevel level, std::string_view filename,
+                      uint32_t line, const char* format, const LogArgs& args, std::string_view message)
+{
+  CrashRing* ring = AcquireRing();
+  if (!ring)
+    return;
+
+  const uint64_t seq = ring->next.load(std::memory_order_relaxed);
+  CrashEntry& slot = ring->entries[seq % ring->capacity];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  // Orders the invalidation before the writes below for dumps running on other threads
+  std::atomic_thread_fence(std::memory_order_release);
+
+  CrashRecord& entry = slot.record;
+
+  entry.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+  entry.level = level;
+  entry.line = line;
+  CopyFilename(entry.filename, filename);
+
+  if (format && args.Size() <= ENTRY_DATA_SIZE)
+  {
+    entry.format = format;
+    entry.size = static_cast<uint16_t>(args.Size());
+    memcpy(entry.data, args.Data(), args.Size());
+  }
+  else if (format)
+  {
+    // Arguments too large to keep raw, store the (truncated) text instead
+    entry.format = nullptr;
+    entry.size = static_cast<uint16_t>(args.RenderTo(reinterpret_cast<char*>(entry.data), ENTRY_DATA_SIZE, format));
+  }
+  else
+  {
+    entry.format = nullptr;
+    entry.size = static_cast<uint16_t>(std::min(message.size(), ENTRY_DATA_SIZE));
+    memcpy(entry.data, message.data(), entry.size);
+  }
+
+  slot.sequence.store(seq + 1, std::memory_order_release);
+  ring->next.store(seq + 1, std::memory_order_release);
+}
+
+void EnableCrashRing(size_t entriesPerThread, LogLevel maxLevel)
+{
+  CacheUtcOffset();
+  gEntriesPerThread = entriesPerThread;
+  gCrashRingLevel = static_cast<int>(maxLevel);
+}
+
+void DisableCrashRing()
+{
+  gCrashRingLevel = -1;
+}
+
+void DumpCrashRing(int fd)
+{
+  for (auto& slot : gRings)
+  {
+    const CrashRing* ring = slot.load(std::memory_order_acquire);
+    if (!ring)
+      continue;
+
+    const uint64_t next = ring->next.load(std::memory_order_acquire);
+    if (next == 0)
+      continue;
+
+    NumberText header;
+    header.Append("--- thread ");
+    header.AppendUnsigned(static_cast<uint64_t>(ring->threadId));
+    header.Append(" ---\n");
+    WriteAll(fd, header.View().data(), header.Size());
+
+    const uint64_t first = next > ring->capacity ? next - ring->capacity : 0;
+    for (uint64_t seq = first; seq < next; ++seq)
+    {
+      const CrashEntry& slot = ring->entries[seq % ring->capacity];
+      if (slot.sequence.load(std::memory_order_acquire) != seq + 1)
+        continue;
+
+      // The owning thread may still be logging, only use the copy if the slot was not
+      // rewritten while copying
+      CrashRecord entry;
+      memcpy(&entry, &slot.record, sizeof(entry));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != seq + 1)
+        continue;
+
+      DumpEntry(fd, entry);
+    }
+  }
+}
+
+void InstallCrashHandler()
+{
+  CacheUtcOffset();
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = CrashSignalHandler;
+  action.sa_flags = SA_RESETHAND;
+  sigemptyset(&action.sa_mask);
+
+  for (int signal : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT})
+    sigaction(signal, &action, nullptr);
+}
+
+}  // namespace logging
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "logging.h"
+
+namespace logging
+{
+
+// Keeps the last entriesPerThread records of every thread in memory, at all
+// levels up to maxLevel, regardless of gMinLogLevel. Nothing is formatted or
+// written until a dump is requested. The per thread size is fixed by the first call.
+void EnableCrashRing(size_t entriesPerThread = 256, LogLevel maxLevel = LogLevel::Trace);
+void DisableCrashRing();
+
+// Writes the rings of all threads to fd, oldest entry first. Does not allocate or
+// take locks, so it can be called from a fatal signal handler. Times use the UTC
+// offset of the moment the ring was enabled or the handler installed. Arguments are
+// formatted without printf, floating point ties may round differently in the last digit.
+void DumpCrashRing(int fd);
+
+// Dumps the crash ring to stderr on SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT
+// before letting the default handler terminate the process
+void InstallCrashHandler();
+
+}  // namespace logging
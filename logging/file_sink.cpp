@@ -0,0 +1,221 @@
+#include "file_sink.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace logging
+{
+
+FileSink::FileSink(const FileSinkOptions& options)
+    : mOptions(options)
+{
+  mBuffer.reserve(mOptions.bufferSize);
+}
+
+FileSink::~FileSink()
+{
+  Close();
+}
+
+VoidResult FileSink::Open()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  VoidResult result = OpenLocked();
+  if (result.IsSuccess())
+    mOpened = true;
+  return result;
+}
+
+void FileSink::Close()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  FlushLocked();
+  mOpened = false;
+  if (mFile)
+  {
+    fclose(mFile);
+    mFile = nullptr;
+  }
+}
+
+void FileSink::Write(const LogRecord& record)
+{
+  Append(record.timestamp, record.level, [this, &record](std::string& out) { FormatRecord(out, record, false); });
+}
+
+void FileSink::Write(std::chrono::system_clock::time_point now, LogLevel level, const std::string& filename,
+                     const uint32_t& line, const std::string& message)
+{
+  Append(now, level, [&](std::string& out) { FormatLine(out, now, level, filename, line, message, false); });
+}
+
+template <class F>
+void FileSink::Append(std::chrono::system_clock::time_point now, LogLevel level, F&& format)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (!mOpened)
+    return;
+
+  const bool failing = !mError.empty();
+  if (failing && mBuffer.size() >= mOptions.bufferSize)
+  {
+    ++mDroppedLines;
+  }
+  else
+  {
+    const size_t previousSize = mBuffer.size();
+    format(mBuffer);
+
+    if (mFile && NeedsRotation(now, mBuffer.size() - previousSize))
+    {
+      // The new line goes to the fresh file
+      std::string pending = mBuffer.substr(previousSize);
+      mBuffer.resize(previousSize);
+      RotateLocked(now);
+      mBuffer += pending;
+    }
+  }
+
+  // Errors are written right away so they survive a crash. While the file can't be
+  // written, it is only retried every flushInterval.
+  const bool due = std::chrono::steady_clock::now() - mLastFlush >= mOptions.flushInterval;
+  if (due || (!failing && (level == LogLevel::Error || mBuffer.size() >= mOptions.bufferSize)))
+    FlushLocked();
+}
+
+void FileSink::Flush()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  FlushLocked();
+}
+
+void FileSink::Tick()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  if ((!mBuffer.empty() || !mError.empty()) &&
+      std::chrono::steady_clock::now() - mLastFlush >= mOptions.flushInterval)
+    FlushLocked();
+}
+
+VoidResult FileSink::Status() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mError.empty() ? VoidResult() : VoidResult::Failed(mError);
+}
+
+VoidResult FileSink::OpenLocked()
+{
+  if (mFile)
+    return VoidResult();
+
+  mFile = fopen(mOptions.path.c_str(), "ab");
+  if (!mFile)
+    return VoidResult::Failed("Can't open log file '" + mOptions.path + "': " + std::string(strerror(errno)));
+
+  // Our own buffer already batches the writes
+  setvbuf(mFile, nullptr, _IONBF, 0);
+
+  fseek(mFile, 0, SEEK_END);
+  const long size = ftell(mFile);
+  mFileSize = size > 0 ? static_cast<uint64_t>(size) : 0;
+  mLastFlush = std::chrono::steady_clock::now();
+  mNextRotation = NextRotation(std::chrono::system_clock::now());
+
+  return VoidResult();
+}
+
+void FileSink::FlushLocked()
+{
+  mLastFlush = std::chrono::steady_clock::now();
+  if (!mOpened)
+    return;
+
+  if (!mFile)
+  {
+    VoidResult opened = OpenLocked();
+    if (!opened.IsSuccess())
+    {
+      SetErrorLocked(opened.ErrorMessage());
+      return;
+    }
+  }
+
+  // A short write keeps the rest for the next attempt
+  const size_t written = fwrite(mBuffer.data(), 1, mBuffer.size(), mFile);
+  mFileSize += written;
+  mBuffer.erase(0, written);
+  if (!mBuffer.empty())
+  {
+    SetErrorLocked("Can't write log file '" + mOptions.path + "': " + std::string(strerror(errno)));
+    clearerr(mFile);
+    return;
+  }
+
+  SetErrorLocked({});
+}
+
+void FileSink::SetErrorLocked(std::string error)
+{
+  if (error == mError)
+    return;
+
+  // Reported once per change, not for every failed attempt
+  if (!error.empty())
+    fprintf(stderr, "%s\n", error.c_str());
+  else if (mDroppedLines > 0)
+    fprintf(stderr, "Log file '%s' is written again, %llu lines were dropped\n", mOptions.path.c_str(),
+            static_cast<unsigned long long>(mDroppedLines));
+  else
+    fprintf(stderr, "Log file '%s' is written again\n", mOptions.path.c_str());
+
+  mError = std::move(error);
+  if (mError.empty())
+    mDroppedLines = 0;
+}
+
+void FileSink::RotateLocked(std::chrono::system_clock::time_point now)
+{
+  FlushLocked();
+  fclose(mFile);
+  mFile = nullptr;
+
+  if (mOptions.maxFiles == 0)
+  {
+    std::remove(mOptions.path.c_str());
+  }
+  else
+  {
+    // path.N-1 -> path.N, ..., path -> path.1, the oldest one is overwritten
+    for (uint32_t i = mOptions.maxFiles - 1; i > 0; --i)
+      std::rename((mOptions.path + "." + std::to_string(i)).c_str(), (mOptions.path + "." + std::to_string(i + 1)).c_str());
+
+    std::rename(mOptions.path.c_str(), (mOptions.path + ".1").c_str());
+  }
+
+  // On failure the lines stay buffered and FlushLocked retries the open
+  VoidResult opened = OpenLocked();
+  if (!opened.IsSuccess())
+    SetErrorLocked(opened.ErrorMessage());
+  mNextRotation = NextRotation(now);
+}
+
+bool FileSink::NeedsRotation(std::chrono::system_clock::time_point now, size_t incoming) const
+{
+  if (mOptions.maxFileSize > 0 && mFileSize + mBuffer.size() > mOptions.maxFileSize &&
+      mFileSize + mBuffer.size() > incoming)
+    return true;
+
+  return mOptions.rotationPeriod.count() > 0 && now >= mNextRotation;
+}
+
+std::chrono::system_clock::time_point FileSink::NextRotation(std::chrono::system_clock::time_point now) const
+{
+  if (mOptions.rotationPeriod.count() <= 0)
+    return std::chrono::system_clock::time_point::max();
+
+  auto sinceEpoch = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch());
+  auto periods = sinceEpoch / mOptions.rotationPeriod;
+  return std::chrono::system_clock::time_point(mOptions.rotationPeriod * (periods + 1));
+}
+
+}  // namespace logging
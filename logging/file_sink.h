@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include "logging.h"
+#include "result.h"
+#include "sinks.h"
+
+namespace logging
+{
+
+struct FileSinkOptions
+{
+  std::string path;
+  // Lines are collected in memory and written once this many bytes are pending
+  size_t bufferSize = 64 * 1024;
+  // Pending lines are also written once this much time passed since the last write. The
+  // check runs on every line and, with async logging, whenever the writer is idle.
+  // Otherwise a quiet logger keeps its lines until the next line or Flush().
+  std::chrono::milliseconds flushInterval = std::chrono::milliseconds(1000);
+  // Rotate when the file would grow past this size, 0 disables size rotation
+  uint64_t maxFileSize = 0;
+  // Rotate on every multiple of this period since the epoch, 0 disables time rotation
+  std::chrono::seconds rotationPeriod = std::chrono::seconds(0);
+  // Rotated files kept as path.1 (newest) ... path.N (oldest)
+  uint32_t maxFiles = 5;
+};
+
+// Buffered, rotating log file, lines are written without terminal colors.
+// When the file can't be written or reopened after a rotation, the error goes to stderr
+// and Status(), up to bufferSize bytes of lines are kept (later ones are dropped) and
+// writing is retried every flushInterval.
+// Besides being added as a sink, its Write overload with the gLogToStream
+// signature lets it be attached directly:
+//   logging::gLogToStream = [sink](auto&&... args) { sink->Write(args...); };
+class FileSink : public Sink
+{
+public:
+  explicit FileSink(const FileSinkOptions& options);
+  ~FileSink();
+
+  FileSink(const FileSink&) = delete;
+  FileSink& operator=(const FileSink&) = delete;
+
+  VoidResult Open();
+  void Close();
+
+  void Write(const LogRecord& record) override;
+  void Write(std::chrono::system_clock::time_point now, LogLevel level, const std::string& filename,
+             const uint32_t& line, const std::string& message);
+  void Flush() override;
+  void Tick() override;
+
+  // Failure of the last write or reopen, success once writing works again
+  VoidResult Status() const;
+
+private:
+  template <class F>
+  void Append(std::chrono::system_clock::time_point now, LogLevel level, F&& format);
+
+  VoidResult OpenLocked();
+  void FlushLocked();
+  void SetErrorLocked(std::string error);
+  void RotateLocked(std::chrono::system_clock::time_point now);
+  bool NeedsRotation(std::chrono::system_clock::time_point now, size_t incoming) const;
+  std::chrono::system_clock::time_point NextRotation(std::chrono::system_clock::time_point now) const;
+
+  const FileSinkOptions mOptions;
+
+  mutable std::mutex mMutex;
+  // Between Open() and Close(), mFile may be missing after a failed reopen
+  bool mOpened = false;
+  FILE* mFile = nullptr;
+  std::string mBuffer;
+  uint64_t mFileSize = 0;
+  std::chrono::steady_clock::time_point mLastFlush;
+  std::chrono::system_clock::time_point mNextRotation;
+  std::string mError;
+  uint64_t mDroppedLines = 0;
+};
+
+}  // namespace logging
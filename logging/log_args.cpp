@@ -0,0 +1,126 @@
+#include "log_args.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace logging
+{
+
+LogArgs::LogArgs(LogArgs&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+LogArgs& LogArgs::operator=(LogArgs&& other) noexcept
+{
+  if (this == &other)
+    return *this;
+
+  mHeap = std::move(other.mHeap);
+  mCapacity = other.mCapacity;
+  mSize = other.mSize;
+  if (!mHeap)
+    memcpy(mInline, other.mInline, mSize);
+
+  other.mCapacity = INLINE_CAPACITY;
+  other.mSize = 0;
+  return *this;
+}
+
+void LogArgs::Clear()
+{
+  mSize = 0;
+}
+
+bool LogArgs::IsEmpty() const
+{
+  return mSize == 0;
+}
+
+void LogArgs::AppendString(std::string_view value)
+{
+  const uint32_t len = static_cast<uint32_t>(value.size());
+  uint8_t* dst = Reserve(1 + sizeof(len) + len + 1);
+  dst[0] = static_cast<uint8_t>(FormatArgType::String);
+  memcpy(dst + 1, &len, sizeof(len));
+  memcpy(dst + 1 + sizeof(len), value.data(), len);
+  dst[1 + sizeof(len) + len] = '\0';
+}
+
+uint8_t* LogArgs::Reserve(size_t bytes)
+{
+  if (mSize + bytes > mCapacity)
+  {
+    size_t capacity = mCapacity * 2;
+    while (capacity < mSize + bytes)
+      capacity *= 2;
+
+    std::unique_ptr<uint8_t[]> heap(new uint8_t[capacity]);
+    memcpy(heap.get(), Data(), mSize);
+    mHeap = std::move(heap);
+    mCapacity = capacity;
+  }
+
+  uint8_t* dst = (mHeap ? mHeap.get() : mInline) + mSize;
+  mSize += bytes;
+  return dst;
+}
+
+const uint8_t* LogArgs::Data() const
+{
+  return mHeap ? mHeap.get() : mInline;
+}
+
+size_t LogArgs::Size() const
+{
+  return mSize;
+}
+
+namespace
+{
+
+// Decodes the arguments into an array and calls render(args, count) with it
+template <class R>
+auto WithArgs(const uint8_t* data, size_t size, R&& render)
+{
+  FormatArg stackArgs[LogArgs::MAX_STACK_ARGS];
+  size_t count = 0;
+  std::vector<FormatArg> heapArgs;
+  LogArgs::ForEachArg(data, size, [&](const FormatArg& arg) {
+    if (count < LogArgs::MAX_STACK_ARGS)
+    {
+      stackArgs[count++] = arg;
+      return;
+    }
+
+    if (heapArgs.empty())
+      heapArgs.assign(stackArgs, stackArgs + count);
+    heapArgs.push_back(arg);
+  });
+
+  return heapArgs.empty() ? render(stackArgs, count) : render(heapArgs.data(), heapArgs.size());
+}
+
+}  // namespace
+
+std::string LogArgs::Render(const char* format) const
+{
+  return WithArgs(Data(), mSize, [format](const FormatArg* args, size_t count) {
+    return FormatArgs(format, args, count);
+  });
+}
+
+size_t LogArgs::RenderTo(char* buffer, size_t size, const char* format) const
+{
+  return RenderTo(buffer, size, format, Data(), mSize);
+}
+
+size_t LogArgs::RenderTo(char* buffer, size_t size, const char* format, const uint8_t* data, size_t dataSize)
+{
+  const size_t length = WithArgs(data, dataSize, [buffer, size, format](const FormatArg* args, size_t count) {
+    return FormatArgsTo(buffer, size, format, args, count);
+  });
+  return size ? std::min(length, size - 1) : 0;
+}
+
+}  // namespace logging
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "format.h"
+
+namespace logging
+{
+
+// Compact, type-tagged copy of printf style arguments. Capturing only copies
+// the raw values (strings inline) so the formatting itself can be done later,
+// on whichever thread ends up writing the record. Rendering decodes them back
+// into FormatArgs and goes through FormatArgsTo, so the output matches Format().
+class LogArgs
+{
+public:
+  static constexpr size_t INLINE_CAPACITY = 128;
+  static constexpr size_t MAX_STACK_ARGS = 32;
+
+  LogArgs() = default;
+  LogArgs(LogArgs&& other) noexcept;
+  LogArgs& operator=(LogArgs&& other) noexcept;
+
+  LogArgs(const LogArgs&) = delete;
+  LogArgs& operator=(const LogArgs&) = delete;
+
+  template <class... Args>
+  void Capture(const Args&... args)
+  {
+    Clear();
+    (Append(args), ...);
+  }
+
+  void Clear();
+  bool IsEmpty() const;
+
+  // Renders the captured arguments using a printf style format string
+  std::string Render(const char* format) const;
+  // Same, into a fixed buffer. Truncates, returns the length written. Only allocates for
+  // more than MAX_STACK_ARGS arguments.
+  size_t RenderTo(char* buffer, size_t size, const char* format) const;
+  // Renders arguments previously copied out through Data()/Size()
+  static size_t RenderTo(char* buffer, size_t size, const char* format, const uint8_t* data, size_t dataSize);
+
+  const uint8_t* Data() const;
+  size_t Size() const;
+
+  // Calls f(const FormatArg&) for every argument copied out through Data()/Size(). Does
+  // not allocate, so it can be used from a signal handler.
+  template <class F>
+  static void ForEachArg(const uint8_t* data, size_t size, F&& f)
+  {
+    const uint8_t* cursor = data;
+    const uint8_t* end = data + size;
+    while (cursor < end)
+    {
+      FormatArg arg;
+      arg.type = static_cast<FormatArgType>(*cursor++);
+      switch (arg.type)
+      {
+        case FormatArgType::Int:
+          memcpy(&arg.i, cursor, sizeof(arg.i));
+          cursor += sizeof(arg.i);
+          break;
+        case FormatArgType::UInt:
+          memcpy(&arg.u, cursor, sizeof(arg.u));
+          cursor += sizeof(arg.u);
+          break;
+        case FormatArgType::Double:
+          memcpy(&arg.d, cursor, sizeof(arg.d));
+          cursor += sizeof(arg.d);
+          break;
+        case FormatArgType::String:
+        {
+          uint32_t len;
+          memcpy(&len, cursor, sizeof(len));
+          arg.s = std::string_view(reinterpret_cast<const char*>(cursor + sizeof(len)), len);
+          cursor += sizeof(len) + len + 1;
+          break;
+        }
+        case FormatArgType::Pointer:
+          memcpy(&arg.p, cursor, sizeof(arg.p));
+          cursor += sizeof(arg.p);
+          break;
+      }
+      f(arg);
+    }
+  }
+
+private:
+  // FormatArg does the type mapping, the switch folds away once inlined
+  template <class T>
+  void Append(const T& value)
+  {
+    const FormatArg arg(value);
+    switch (arg.type)
+    {
+      case FormatArgType::Int:
+        AppendScalar(arg.type, arg.i);
+        break;
+      case FormatArgType::UInt:
+        AppendScalar(arg.type, arg.u);
+        break;
+      case FormatArgType::Double:
+        AppendScalar(arg.type, arg.d);
+        break;
+      case FormatArgType::String:
+        AppendString(arg.s);
+        break;
+      case FormatArgType::Pointer:
+        AppendScalar(arg.type, arg.p);
+        break;
+    }
+  }
+
+  template <class T>
+  void AppendScalar(FormatArgType type, T value)
+  {
+    uint8_t* dst = Reserve(1 + sizeof(T));
+    dst[0] = static_cast<uint8_t>(type);
+    memcpy(dst + 1, &value, sizeof(T));
+  }
+
+  void AppendString(std::string_view value);
+  uint8_t* Reserve(size_t bytes);
+
+  uint8_t mInline[INLINE_CAPACITY];
+  // Only used once the arguments outgrow the inline buffer
+  std::unique_ptr<uint8_t[]> mHeap;
+  size_t mCapacity = INLINE_CAPACITY;
+  size_t mSize = 0;
+};
+
+}  // namespace logging
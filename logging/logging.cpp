@@ -1,8 +1,12 @@
 #include "logging.h"
 
-#include <mutex>
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <sstream>
 
+#include "async_logger.h"
+#include "sink_registry.h"
 #include "termcolor.h"
 
 namespace logging
@@ -12,10 +16,25 @@ bool gSilentLog = false;
 LogLevel gMinLogLevel = LogLevel::Debugging;
 std::function<void(std::chrono::system_clock::time_point ts, logging::LogLevel level, const std::string& filename, const uint32_t& line, const std::string& message)> gLogToStream = nullptr;
 
-std::string LevelToString(LogLevel logLevel)
+// Built on first use and never destroyed: static constructors of other files may log
+// before this file is initialized, and the async writer may still dispatch during
+// static destruction
+static SinkRegistry& Sinks()
+{
+  static SinkRegistry* sinks = new SinkRegistry();
+  return *sinks;
+}
+
+namespace
+{
+
+// Every LogLevel plus the "unknown" fallback
+constexpr size_t LEVEL_COUNT = static_cast<size_t>(LogLevel::Trace) + 2;
+
+std::string RenderLevel(LogLevel logLevel, bool colored)
 {
   std::stringstream strStream;
-  strStream << termcolor::colorize;
+  strStream << (colored ? termcolor::colorize : termcolor::nocolorize);
   switch (logLevel)
   {
     case LogLevel::Error:
@@ -40,6 +59,59 @@ std::string LevelToString(LogLevel logLevel)
   return strStream.str();
 }
 
+std::array<std::string, LEVEL_COUNT> RenderLevels(bool colored)
+{
+  std::array<std::string, LEVEL_COUNT> levels;
+  for (size_t i = 0; i < LEVEL_COUNT; ++i)
+    levels[i] = RenderLevel(static_cast<LogLevel>(i), colored);
+
+  return levels;
+}
+
+// Date and time up to the seconds, only rebuilt when the second changes
+struct TimeCache
+{
+  std::time_t second = -1;
+  char text[32];
+  size_t length = 0;
+};
+
+// Recent paths given to ShortFilename and their interned names, per thread so calls
+// with a file name known only at runtime do not take the pool lock every time.
+// Trivially destructible, so it still works for log lines from static destructors.
+struct ShortFilenameCache
+{
+  static constexpr size_t SIZE = 8;
+  static constexpr size_t MAX_PATH_SIZE = 256;
+
+  struct Entry
+  {
+    char path[MAX_PATH_SIZE];
+    size_t pathSize = 0;
+    std::string_view shortName;
+  };
+
+  Entry entries[SIZE];
+};
+
+}  // namespace
+
+const std::string& LevelPrefix(LogLevel logLevel, bool colored)
+{
+  // Rendered once, the stringstream is too expensive to build per line. Function statics
+  // so they are ready for log lines from static constructors of other files.
+  static const std::array<std::string, LEVEL_COUNT> coloredLevels = RenderLevels(true);
+  static const std::array<std::string, LEVEL_COUNT> plainLevels = RenderLevels(false);
+
+  const size_t idx = std::min(static_cast<size_t>(logLevel), LEVEL_COUNT - 1);
+  return colored ? coloredLevels[idx] : plainLevels[idx];
+}
+
+std::string LevelToString(LogLevel logLevel)
+{
+  return LevelPrefix(logLevel, true);
+}
+
 std::tm ToLocalTm(std::time_t now)
 {
   std::tm tm{};
@@ -51,54 +123,230 @@ std::tm ToLocalTm(std::time_t now)
   return tm;
 }
 
-std::string TimeToString(std::chrono::system_clock::time_point now)
+void AppendTime(std::string& out, std::chrono::system_clock::time_point now)
 {
+  thread_local TimeCache cache;
+
   auto secs = std::chrono::time_point_cast<std::chrono::seconds>(now);
   auto micros = std::chrono::duration_cast<std::chrono::microseconds>(now - secs).count();
   auto t = std::chrono::system_clock::to_time_t(secs);
-  std::tm tm = ToLocalTm(t);
 
-  return Format(
-      "%02d/%02d/%04d %02d:%02d:%02d.%09lld",
-      tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900,
-      tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<long long>(micros));
+  if (t != cache.second)
+  {
+    std::tm tm = ToLocalTm(t);
+    int len = snprintf(cache.text, sizeof(cache.text), "%02d/%02d/%04d %02d:%02d:%02d.",
+                       tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900,
+                       tm.tm_hour, tm.tm_min, tm.tm_sec);
+    cache.length = len > 0 ? std::min(static_cast<size_t>(len), sizeof(cache.text) - 1) : 0;
+    cache.second = t;
+  }
+  out.append(cache.text, cache.length);
+
+  // Sub-second part, zero padded to 9 digits
+  char digits[9];
+  long long value = static_cast<long long>(micros);
+  for (int i = 8; i >= 0; --i)
+  {
+    digits[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  out.append(digits, sizeof(digits));
 }
 
-void Print(std::chrono::system_clock::time_point now, LogLevel level, const std::string& filename,
-           const uint32_t& line, const std::string& message)
+std::string TimeToString(std::chrono::system_clock::time_point now)
 {
-  const std::string msg = Format("%s [%s] %s:%u: %s\n", TimeToString(now).c_str(), LevelToString(level).c_str(), filename.c_str(), line, message.c_str());
-  if (level == LogLevel::Error)
+  std::string out;
+  AppendTime(out, now);
+  return out;
+}
+
+void FormatLine(std::string& out, std::chrono::system_clock::time_point now, LogLevel level,
+                std::string_view filename, uint32_t line, const std::string& message, bool colored)
+{
+  char lineNumber[16];
+  auto [end, ec] = std::to_chars(lineNumber, lineNumber + sizeof(lineNumber), line);
+
+  out.reserve(out.size() + 48 + filename.size() + message.size());
+  AppendTime(out, now);
+  out += " [";
+  out += LevelPrefix(level, colored);
+  out += "] ";
+  out += filename;
+  out += ':';
+  out.append(lineNumber, end - lineNumber);
+  out += ": ";
+  out += message;
+  out += '\n';
+}
+
+std::string_view ShortFilename(std::string_view path)
+{
+  thread_local ShortFilenameCache cache;
+
+  // Callers mostly pass the same few buffers (__FILE__, a member string), the address
+  // picks the slot and the content decides
+  const size_t slot = (reinterpret_cast<uintptr_t>(path.data()) >> 4) % ShortFilenameCache::SIZE;
+  ShortFilenameCache::Entry& entry = cache.entries[slot];
+  if (entry.shortName.data() && std::string_view(entry.path, entry.pathSize) == path)
+    return entry.shortName;
+
+  // Get filename minus the extension
+  const size_t idx = path.find_last_of('/') + 1;
+  const size_t size = path.find_last_of('.') - idx;
+  const std::string_view shortName = StringPool::Global().Intern(path.substr(idx, size));
+
+  // Longer paths are not cached
+  if (path.size() <= ShortFilenameCache::MAX_PATH_SIZE)
   {
-    fprintf(stderr, "%s", msg.data());
-    fflush(stderr);
+    entry.pathSize = path.copy(entry.path, path.size());
+    entry.shortName = shortName;
   }
-  else
+  return shortName;
+}
+
+void Print(std::chrono::system_clock::time_point now, LogLevel level, const std::string& filename,
+           const uint32_t& line, const std::string& message)
+{
+  thread_local std::string msg;
+  msg.clear();
+  FormatLine(msg, now, level, filename, line, message, true);
+
+  FILE* stream = level == LogLevel::Error ? stderr : stdout;
+  fwrite(msg.data(), 1, msg.size(), stream);
+  fflush(stream);
+}
+
+void Dispatch(LogRecord& record)
+{
+  auto render = [&record]() {
+    if (record.format)
+    {
+      record.message = record.args.Render(record.format);
+      record.format = nullptr;
+    }
+  };
+
+  if (gLogToStream)
   {
-    fprintf(stdout, "%s", msg.data());
-    fflush(stdout);
+    render();
+    gLogToStream(record.timestamp, record.level, std::string(record.filename), record.line, record.message);
   }
+
+  // Only render the message if some sink wants it
+  Sinks().ForEach([&record, &render](Sink& sink) {
+    if (!sink.Accepts(record.level))
+      return;
+
+    render();
+    sink.Write(record);
+  });
+}
+
+void FlushOutputs()
+{
+  Sinks().ForEach([](Sink& sink) { sink.Flush(); });
+  fflush(stdout);
+  fflush(stderr);
+}
+
+void TickOutputs()
+{
+  Sinks().ForEach([](Sink& sink) { sink.Tick(); });
+}
+
+SinkId AddSink(std::shared_ptr<Sink> sink)
+{
+  return Sinks().Add(std::move(sink));
+}
+
+bool RemoveSink(SinkId id)
+{
+  return Sinks().Remove(id);
+}
+
+void ClearSinks()
+{
+  Sinks().Clear();
+}
+
+LogRecord MakeRecord(LogLevel level, std::string_view filename, uint32_t line,
+                     std::chrono::system_clock::time_point now)
+{
+  LogRecord record;
+  record.timestamp = now;
+  record.level = level;
+  record.filename = filename;
+  record.line = line;
+  return record;
+}
+
+void Submit(LogRecord&& record)
+{
+  if (AsyncLogger::Instance().TryLog(std::move(record)))
+    return;
+
+  Dispatch(record);
 }
 
 void Log(LogLevel level, const std::string& filename, const uint32_t& line,
          const std::string& message)
 {
-  static std::mutex mPrintfMutex;
-  if (level > gMinLogLevel || gSilentLog)
+  if (!IsEnabled(level))
     return;
 
-  auto now = std::chrono::system_clock::now();
+  LogRecord record = MakeRecord(level, ShortFilename(filename), line);
+  if (CrashRingAccepts(level))
+    RecordCrashEntry(record.timestamp, level, record.filename, line, nullptr, record.args, message);
 
-  // Get filename minus the extension
-  const uint32_t idx = filename.find_last_of('/') + 1;
-  const uint32_t size = filename.find_last_of('.') - idx;
-  const std::string shortFilename = filename.substr(idx, size);
+  if (!ShouldDispatch(level))
+    return;
 
-  if (gLogToStream)
-    gLogToStream(now, level, shortFilename, line, message);
+  record.message = message;
+  Submit(std::move(record));
+}
+
+void LogStructured(LogLevel level, std::string_view filename, uint32_t line, std::string_view message,
+                   LogFields fields)
+{
+  if (!IsEnabled(level))
+    return;
+
+  LogRecord record = MakeRecord(level, filename, line);
+  if (CrashRingAccepts(level))
+    RecordCrashEntry(record.timestamp, level, filename, line, nullptr, record.args, message);
+
+  if (!ShouldDispatch(level))
+    return;
+
+  record.message = std::string(message);
+  record.fields = std::move(fields);
+  Submit(std::move(record));
+}
 
-  std::lock_guard<std::mutex> lock(mPrintfMutex);
-  Print(now, level, shortFilename, line, message);
+void EnableAsync(size_t capacity, OverflowPolicy policy)
+{
+  AsyncLogger::Instance().Start(capacity, policy);
+}
+
+void DisableAsync()
+{
+  AsyncLogger::Instance().Stop();
+}
+
+bool IsAsync()
+{
+  return AsyncLogger::Instance().IsRunning();
+}
+
+void Flush()
+{
+  AsyncLogger::Instance().Flush();
+  FlushOutputs();
+}
+
+uint64_t DroppedMessages()
+{
+  return AsyncLogger::Instance().Dropped();
 }
 
 }  // namespace logging
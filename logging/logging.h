@@ -2,11 +2,25 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
+#include "log_args.h"
+#include "rate_limit.h"
 #include "string_helpers.h"
+#include "string_pool.h"
+#include "structured.h"
+
+// Statements below this level are removed at compile time.
+// 0 = Error, 1 = Warning, 2 = Info, 3 = Debugging, 4 = Trace
+#ifndef CPPHELPERS_LOG_COMPILE_LEVEL
+#define CPPHELPERS_LOG_COMPILE_LEVEL 4
+#endif
 
 namespace logging
 {
@@ -20,38 +34,316 @@ enum class LogLevel
   Trace
 };
 
+// What a producer does when the async queue is full
+enum class OverflowPolicy
+{
+  Block,
+  DropNewest,
+  DropOldest
+};
+
+class Sink;
+using SinkId = uint32_t;
+
+// Id of the console sink registered by default
+constexpr SinkId CONSOLE_SINK = 0;
+
+struct LogRecord
+{
+  std::chrono::system_clock::time_point timestamp;
+  LogLevel level;
+  // Short file name (see ShortFilename), interned so it stays valid forever. Decoded
+  // records point into the pool given to DecodeBinary instead.
+  std::string_view filename;
+  uint32_t line;
+  std::string message;
+
+  // Deferred formatting, when set the message is rendered from args by the writer
+  const char* format = nullptr;
+  LogArgs args;
+
+  // Typed key/value pairs of structured records
+  LogFields fields;
+};
+
 extern bool gSilentLog;
 extern logging::LogLevel gMinLogLevel;
+// Lowest level kept in the crash ring (see crash_ring.h), -1 while it is disabled
+extern std::atomic<int> gCrashRingLevel;
 extern std::function<void(std::chrono::system_clock::time_point now, logging::LogLevel level,
                           const std::string& filename, const uint32_t& line,
                           const std::string& message)>
     gLogToStream;
 
 std::string LevelToString(LogLevel logLevel);
+// Precomputed level tag, with or without terminal colors
+const std::string& LevelPrefix(LogLevel logLevel, bool colored);
 std::tm ToLocalTm(std::time_t now);
 std::string TimeToString(std::chrono::system_clock::time_point tp);
+void AppendTime(std::string& out, std::chrono::system_clock::time_point tp);
+
+// Appends a full "<time> [<level>] <file>:<line>: <message>" line, newline included
+void FormatLine(std::string& out, std::chrono::system_clock::time_point now, LogLevel level,
+                std::string_view filename, uint32_t line, const std::string& message, bool colored);
+
+// File name without directories and extension, interned in StringPool::Global(). Recent
+// paths are cached per thread, so repeated calls for the same file do not lock the pool.
+std::string_view ShortFilename(std::string_view path);
 
 void Print(std::chrono::system_clock::time_point now, LogLevel level, const std::string& filename,
            const uint32_t& line, const std::string& message);
 void Log(LogLevel level, const std::string& filename, const uint32_t& line,
          const std::string& message);
 
+// Whether a record at this level reaches the sinks
+inline bool ShouldDispatch(LogLevel level)
+{
+  return level <= gMinLogLevel && !gSilentLog;
+}
+
+inline bool CrashRingAccepts(LogLevel level)
+{
+  return static_cast<int>(level) <= gCrashRingLevel.load(std::memory_order_relaxed);
+}
+
+inline bool IsEnabled(LogLevel level)
+{
+  return ShouldDispatch(level) || CrashRingAccepts(level);
+}
+
+// filename is a short name from ShortFilename()
+LogRecord MakeRecord(LogLevel level, std::string_view filename, uint32_t line,
+                     std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+
+// Stores an entry in the calling thread's crash ring. Either format (a string
+// literal rendered with args at dump time) or message is used.
+void RecordCrashEntry(std::chrono::system_clock::time_point now, LogLevel level, std::string_view filename,
+                      uint32_t line, const char* format, const LogArgs& args, std::string_view message);
+// Queues the record when async mode is on, writes it right away otherwise
+void Submit(LogRecord&& record);
+
+inline const char* FormatString(const char* format)
+{
+  return format;
+}
+
+inline const char* FormatString(const std::string& format)
+{
+  return format.c_str();
+}
+
+// filename is a short name from ShortFilename(), the macros compute it once per call site.
+// Captures the raw arguments instead of formatting them on the calling thread.
+// Only a format the macros saw spelled as a string literal (see LOG_FORMAT_IS_LITERAL)
+// is kept by pointer. Any other one, a local char array included, is rendered right
+// away since it may not outlive the record.
+template <bool LITERAL, class F, class... Args>
+void LogFormat(LogLevel level, std::string_view filename, uint32_t line, std::bool_constant<LITERAL>,
+               const F& format, const Args&... args)
+{
+  const bool dispatch = ShouldDispatch(level);
+  const bool crashRing = CrashRingAccepts(level);
+  if (!dispatch && !crashRing)
+    return;
+
+  const auto now = std::chrono::system_clock::now();
+  LogArgs captured;
+  captured.Capture(args...);
+
+  const char* literal = nullptr;
+  std::string message;
+  // Spelled with a leading literal is not enough, "text: " + str is a std::string
+  if constexpr (LITERAL && std::is_convertible_v<const F&, const char*>)
+    literal = format;
+  else
+    message = captured.Render(FormatString(format));
+
+  if (crashRing)
+    RecordCrashEntry(now, level, filename, line, literal, captured, message);
+
+  if (!dispatch)
+    return;
+
+  LogRecord record = MakeRecord(level, filename, line, now);
+  record.format = literal;
+  record.message = std::move(message);
+  record.args = std::move(captured);
+  Submit(std::move(record));
+}
+
+// Logs a message with typed fields, see FormatJsonLine and FormatBinary for encoders.
+// filename is a short name from ShortFilename().
+void LogStructured(LogLevel level, std::string_view filename, uint32_t line, std::string_view message,
+                   LogFields fields);
+
+// Writes a record to gLogToStream and every registered sink on the calling thread
+void Dispatch(LogRecord& record);
+void FlushOutputs();
+// Lets every registered sink do its time based work, see Sink::Tick
+void TickOutputs();
+
+// Sinks can be added and removed at any time, each one filters on its own minimum level.
+// Must not be called from within a sink's Write.
+SinkId AddSink(std::shared_ptr<Sink> sink);
+bool RemoveSink(SinkId id);
+void ClearSinks();
+
+// Hands records to a background writer thread instead of printing on the caller's thread
+void EnableAsync(size_t capacity = 8192, OverflowPolicy policy = OverflowPolicy::Block);
+// Drains all pending records and stops the writer thread
+void DisableAsync();
+bool IsAsync();
+// Blocks until every record logged before the call has been written
+void Flush();
+uint64_t DroppedMessages();
+
 }  // namespace logging
 
-#define LOG_ERROR(s, ...)                                    \
-  logging::Log(logging::LogLevel::Error, __FILE__, __LINE__, \
-               Format(s, ##__VA_ARGS__))
-#define LOG_WARNING(s, ...)                                    \
-  logging::Log(logging::LogLevel::Warning, __FILE__, __LINE__, \
-               Format(s, ##__VA_ARGS__))
-#define LOG_INFO(s, ...)                                    \
-  logging::Log(logging::LogLevel::Info, __FILE__, __LINE__, \
-               Format(s, ##__VA_ARGS__))
-#define LOG_INFO_RAW(f, l, s, ...) \
-  logging::Log(logging::LogLevel::Info, f, l, Format(s, ##__VA_ARGS__))
-#define LOG_DEBUG(s, ...)                                        \
-  logging::Log(logging::LogLevel::Debugging, __FILE__, __LINE__, \
-               Format(s, ##__VA_ARGS__))
-#define LOG_TRACE(s, ...)                                    \
-  logging::Log(logging::LogLevel::Trace, __FILE__, __LINE__, \
-               Format(s, ##__VA_ARGS__))
+// Short name of the current file, computed and interned only once per call site
+#define LOG_SHORT_FILE                                                             \
+  ([]() {                                                                          \
+    static const std::string_view logShortFile = logging::ShortFilename(__FILE__); \
+    return logShortFile;                                                           \
+  }())
+
+// Whether the format argument is spelled as a string literal. Arrays and pointers
+// have the same type, so only the spelling tells that it lives for the whole program.
+// Expressions starting with a literal also match, LogFormat checks the type as well.
+#define LOG_FORMAT_IS_LITERAL(s) std::bool_constant<(#s)[0] == '"'>()
+
+// The level is checked before any of the arguments are evaluated. f is a short file name.
+#define LOG_AT_LEVEL(level, f, l, s, ...)                                          \
+  do                                                                               \
+  {                                                                                \
+    if (logging::IsEnabled(level))                                                 \
+      logging::LogFormat(level, f, l, LOG_FORMAT_IS_LITERAL(s), s, ##__VA_ARGS__); \
+  } while (0)
+
+#define LOG_FIELDS_AT_LEVEL(level, f, l, s, ...)                               \
+  do                                                                           \
+  {                                                                            \
+    if (logging::IsEnabled(level))                                             \
+      logging::LogStructured(level, f, l, s, logging::LogFields{__VA_ARGS__}); \
+  } while (0)
+
+// Logs the 1st, (n+1)th, (2n+1)th... time the statement is reached
+#define LOG_EVERY_N_AT_LEVEL(level, n, s, ...)                                                         \
+  do                                                                                                   \
+  {                                                                                                    \
+    static logging::EveryN logEveryN;                                                                  \
+    if (logging::IsEnabled(level) && logEveryN.Tick(n))                                                \
+      logging::LogFormat(level, LOG_SHORT_FILE, __LINE__, LOG_FORMAT_IS_LITERAL(s), s, ##__VA_ARGS__); \
+  } while (0)
+
+// Logs only the first n times the statement is reached
+#define LOG_FIRST_N_AT_LEVEL(level, n, s, ...)                                                         \
+  do                                                                                                   \
+  {                                                                                                    \
+    static logging::FirstN logFirstN;                                                                  \
+    if (logging::IsEnabled(level) && logFirstN.Tick(n))                                                \
+      logging::LogFormat(level, LOG_SHORT_FILE, __LINE__, LOG_FORMAT_IS_LITERAL(s), s, ##__VA_ARGS__); \
+  } while (0)
+
+// Logs at most once every ms milliseconds, preceded by the number of
+// messages suppressed since the previous one
+#define LOG_RATE_LIMITED_AT_LEVEL(level, ms, s, ...)                                                                      \
+  do                                                                                                                      \
+  {                                                                                                                       \
+    static logging::RateLimiter logRateLimiter;                                                                           \
+    uint64_t logSuppressed = 0;                                                                                           \
+    if (logging::IsEnabled(level) && logRateLimiter.Tick(std::chrono::milliseconds(ms), logSuppressed))                   \
+    {                                                                                                                     \
+      if (logSuppressed)                                                                                                  \
+        logging::LogFormat(level, LOG_SHORT_FILE, __LINE__, std::true_type(), "Suppressed %llu messages", logSuppressed); \
+      logging::LogFormat(level, LOG_SHORT_FILE, __LINE__, LOG_FORMAT_IS_LITERAL(s), s, ##__VA_ARGS__);                    \
+    }                                                                                                                     \
+  } while (0)
+
+// Compiled out statement, the arguments are only named in an unevaluated
+// context so they do not trigger unused variable warnings
+#define LOG_DISCARD(level, f, l, s, ...)                                                     \
+  do                                                                                         \
+  {                                                                                          \
+    (void)sizeof((logging::LogFormat(level, f, l, std::false_type(), s, ##__VA_ARGS__), 0)); \
+  } while (0)
+
+#define LOG_FIELDS_DISCARD(level, f, l, s, ...)                                                 \
+  do                                                                                            \
+  {                                                                                             \
+    (void)sizeof((logging::LogStructured(level, f, l, s, logging::LogFields{__VA_ARGS__}), 0)); \
+  } while (0)
+
+// Structured variants take the fields as {key, value} pairs:
+//   LOG_INFO_FIELDS("Request done", {"status", 200}, {"path", path});
+
+#if CPPHELPERS_LOG_COMPILE_LEVEL >= 0
+#define LOG_ERROR(s, ...) LOG_AT_LEVEL(logging::LogLevel::Error, LOG_SHORT_FILE, __LINE__, s, ##__VA_ARGS__)
+#define LOG_ERROR_FIELDS(s, ...) LOG_FIELDS_AT_LEVEL(logging::LogLevel::Error, LOG_SHORT_FILE, __LINE__, s, __VA_ARGS__)
+#define LOG_ERROR_EVERY_N(n, s, ...) LOG_EVERY_N_AT_LEVEL(logging::LogLevel::Error, n, s, ##__VA_ARGS__)
+#define LOG_ERROR_FIRST_N(n, s, ...) LOG_FIRST_N_AT_LEVEL(logging::LogLevel::Error, n, s, ##__VA_ARGS__)
+#define LOG_ERROR_RATE_LIMITED(ms, s, ...) LOG_RATE_LIMITED_AT_LEVEL(logging::LogLevel::Error, ms, s, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(s, ...) LOG_DISCARD(logging::LogLevel::Error, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_ERROR_FIELDS(s, ...) LOG_FIELDS_DISCARD(logging::LogLevel::Error, __FILE__, __LINE__, s, __VA_ARGS__)
+#define LOG_ERROR_EVERY_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Error, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_ERROR_FIRST_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Error, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_ERROR_RATE_LIMITED(ms, s, ...) LOG_DISCARD(logging::LogLevel::Error, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#endif
+
+#if CPPHELPERS_LOG_COMPILE_LEVEL >= 1
+#define LOG_WARNING(s, ...) LOG_AT_LEVEL(logging::LogLevel::Warning, LOG_SHORT_FILE, __LINE__, s, ##__VA_ARGS__)
+#define LOG_WARNING_FIELDS(s, ...) LOG_FIELDS_AT_LEVEL(logging::LogLevel::Warning, LOG_SHORT_FILE, __LINE__, s, __VA_ARGS__)
+#define LOG_WARNING_EVERY_N(n, s, ...) LOG_EVERY_N_AT_LEVEL(logging::LogLevel::Warning, n, s, ##__VA_ARGS__)
+#define LOG_WARNING_FIRST_N(n, s, ...) LOG_FIRST_N_AT_LEVEL(logging::LogLevel::Warning, n, s, ##__VA_ARGS__)
+#define LOG_WARNING_RATE_LIMITED(ms, s, ...) LOG_RATE_LIMITED_AT_LEVEL(logging::LogLevel::Warning, ms, s, ##__VA_ARGS__)
+#else
+#define LOG_WARNING(s, ...) LOG_DISCARD(logging::LogLevel::Warning, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_WARNING_FIELDS(s, ...) LOG_FIELDS_DISCARD(logging::LogLevel::Warning, __FILE__, __LINE__, s, __VA_ARGS__)
+#define LOG_WARNING_EVERY_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Warning, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_WARNING_FIRST_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Warning, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_WARNING_RATE_LIMITED(ms, s, ...) LOG_DISCARD(logging::LogLevel::Warning, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#endif
+
+#if CPPHELPERS_LOG_COMPILE_LEVEL >= 2
+#define LOG_INFO(s, ...) LOG_AT_LEVEL(logging::LogLevel::Info, LOG_SHORT_FILE, __LINE__, s, ##__VA_ARGS__)
+#define LOG_INFO_FIELDS(s, ...) LOG_FIELDS_AT_LEVEL(logging::LogLevel::Info, LOG_SHORT_FILE, __LINE__, s, __VA_ARGS__)
+#define LOG_INFO_EVERY_N(n, s, ...) LOG_EVERY_N_AT_LEVEL(logging::LogLevel::Info, n, s, ##__VA_ARGS__)
+#define LOG_INFO_FIRST_N(n, s, ...) LOG_FIRST_N_AT_LEVEL(logging::LogLevel::Info, n, s, ##__VA_ARGS__)
+#define LOG_INFO_RATE_LIMITED(ms, s, ...) LOG_RATE_LIMITED_AT_LEVEL(logging::LogLevel::Info, ms, s, ##__VA_ARGS__)
+#define LOG_INFO_RAW(f, l, s, ...) LOG_AT_LEVEL(logging::LogLevel::Info, logging::ShortFilename(f), l, s, ##__VA_ARGS__)
+#else
+#define LOG_INFO(s, ...) LOG_DISCARD(logging::LogLevel::Info, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_INFO_FIELDS(s, ...) LOG_FIELDS_DISCARD(logging::LogLevel::Info, __FILE__, __LINE__, s, __VA_ARGS__)
+#define LOG_INFO_EVERY_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Info, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_INFO_FIRST_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Info, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_INFO_RATE_LIMITED(ms, s, ...) LOG_DISCARD(logging::LogLevel::Info, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_INFO_RAW(f, l, s, ...) LOG_DISCARD(logging::LogLevel::Info, f, l, s, ##__VA_ARGS__)
+#endif
+
+#if CPPHELPERS_LOG_COMPILE_LEVEL >= 3
+#define LOG_DEBUG(s, ...) LOG_AT_LEVEL(logging::LogLevel::Debugging, LOG_SHORT_FILE, __LINE__, s, ##__VA_ARGS__)
+#define LOG_DEBUG_FIELDS(s, ...) LOG_FIELDS_AT_LEVEL(logging::LogLevel::Debugging, LOG_SHORT_FILE, __LINE__, s, __VA_ARGS__)
+#define LOG_DEBUG_EVERY_N(n, s, ...) LOG_EVERY_N_AT_LEVEL(logging::LogLevel::Debugging, n, s, ##__VA_ARGS__)
+#define LOG_DEBUG_FIRST_N(n, s, ...) LOG_FIRST_N_AT_LEVEL(logging::LogLevel::Debugging, n, s, ##__VA_ARGS__)
+#define LOG_DEBUG_RATE_LIMITED(ms, s, ...) LOG_RATE_LIMITED_AT_LEVEL(logging::LogLevel::Debugging, ms, s, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(s, ...) LOG_DISCARD(logging::LogLevel::Debugging, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_DEBUG_FIELDS(s, ...) LOG_FIELDS_DISCARD(logging::LogLevel::Debugging, __FILE__, __LINE__, s, __VA_ARGS__)
+#define LOG_DEBUG_EVERY_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Debugging, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_DEBUG_FIRST_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Debugging, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_DEBUG_RATE_LIMITED(ms, s, ...) LOG_DISCARD(logging::LogLevel::Debugging, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#endif
+
+#if CPPHELPERS_LOG_COMPILE_LEVEL >= 4
+#define LOG_TRACE(s, ...) LOG_AT_LEVEL(logging::LogLevel::Trace, LOG_SHORT_FILE, __LINE__, s, ##__VA_ARGS__)
+#define LOG_TRACE_FIELDS(s, ...) LOG_FIELDS_AT_LEVEL(logging::LogLevel::Trace, LOG_SHORT_FILE, __LINE__, s, __VA_ARGS__)
+#define LOG_TRACE_EVERY_N(n, s, ...) LOG_EVERY_N_AT_LEVEL(logging::LogLevel::Trace, n, s, ##__VA_ARGS__)
+#define LOG_TRACE_FIRST_N(n, s, ...) LOG_FIRST_N_AT_LEVEL(logging::LogLevel::Trace, n, s, ##__VA_ARGS__)
+#define LOG_TRACE_RATE_LIMITED(ms, s, ...) LOG_RATE_LIMITED_AT_LEVEL(logging::LogLevel::Trace, ms, s, ##__VA_ARGS__)
+#else
+#define LOG_TRACE(s, ...) LOG_DISCARD(logging::LogLevel::Trace, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_TRACE_FIELDS(s, ...) LOG_FIELDS_DISCARD(logging::LogLevel::Trace, __FILE__, __LINE__, s, __VA_ARGS__)
+#define LOG_TRACE_EVERY_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Trace, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_TRACE_FIRST_N(n, s, ...) LOG_DISCARD(logging::LogLevel::Trace, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#define LOG_TRACE_RATE_LIMITED(ms, s, ...) LOG_DISCARD(logging::LogLevel::Trace, __FILE__, __LINE__, s, ##__VA_ARGS__)
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace logging
+{
+
+// Per call site state of the LOG_*_EVERY_N, LOG_*_FIRST_N and LOG_*_RATE_LIMITED
+// macros. A suppressed call only costs an atomic increment (plus a monotonic
+// clock read for the rate limiter).
+
+class EveryN
+{
+public:
+  // True for the 1st, (n+1)th, (2n+1)th... call
+  bool Tick(uint64_t n)
+  {
+    return mCount.fetch_add(1, std::memory_order_relaxed) % (n ? n : 1) == 0;
+  }
+
+private:
+  std::atomic<uint64_t> mCount = 0;
+};
+
+class FirstN
+{
+public:
+  // True for the first n calls
+  bool Tick(uint64_t n)
+  {
+    return mCount.load(std::memory_order_relaxed) < n && mCount.fetch_add(1, std::memory_order_relaxed) < n;
+  }
+
+private:
+  std::atomic<uint64_t> mCount = 0;
+};
+
+class RateLimiter
+{
+public:
+  // True at most once per window. When it fires, suppressed holds the
+  // number of calls dropped since the previous one.
+  bool Tick(std::chrono::milliseconds window, uint64_t& suppressed)
+  {
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t next = mNextAllowed.load(std::memory_order_relaxed);
+    if (now < next || !mNextAllowed.compare_exchange_strong(next, now + std::chrono::duration_cast<std::chrono::nanoseconds>(window).count(), std::memory_order_relaxed))
+    {
+      mSuppressed.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    suppressed = mSuppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  std::atomic<int64_t> mNextAllowed = INT64_MIN;
+  std::atomic<uint64_t> mSuppressed = 0;
+};
+
+}  // namespace logging
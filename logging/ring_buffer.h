@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+// Bounded lock-free queue based on Dmitry Vyukov's MPMC array queue.
+// Every cell carries a sequence number telling producers and consumers
+// whether it is free to be written or ready to be read, so neither side
+// ever takes a lock. The capacity is rounded up to a power of two.
+template <class T>
+class RingBuffer
+{
+public:
+  explicit RingBuffer(size_t capacity)
+      : mMask(RoundUp(capacity) - 1)
+      , mCells(new Cell[mMask + 1])
+  {
+    for (size_t i = 0; i <= mMask; ++i)
+      mCells[i].sequence.store(i, std::memory_order_relaxed);
+
+    mEnqueuePos.store(0, std::memory_order_relaxed);
+    mDequeuePos.store(0, std::memory_order_relaxed);
+  }
+
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer& operator=(const RingBuffer&) = delete;
+
+  bool TryPush(T&& value)
+  {
+    Cell* cell;
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &mCells[pos & mMask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0)
+      {
+        if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        // Full
+        return false;
+      }
+      else
+      {
+        pos = mEnqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->data = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value)
+  {
+    Cell* cell;
+    size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &mCells[pos & mMask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0)
+      {
+        if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        // Empty
+        return false;
+      }
+      else
+      {
+        pos = mDequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    value = std::move(cell->data);
+    cell->sequence.store(pos + mMask + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool IsEmpty() const
+  {
+    return mEnqueuePos.load(std::memory_order_acquire) == mDequeuePos.load(std::memory_order_acquire);
+  }
+
+  size_t Capacity() const
+  {
+    return mMask + 1;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  static size_t RoundUp(size_t v)
+  {
+    size_t r = 2;
+    while (r < v)
+      r <<= 1;
+
+    return r;
+  }
+
+  const size_t mMask;
+  std::unique_ptr<Cell[]> mCells;
+
+  // Keep producer and consumer positions on separate cache lines
+  alignas(64) std::atomic<size_t> mEnqueuePos;
+  alignas(64) std::atomic<size_t> mDequeuePos;
+};
@@ -0,0 +1,67 @@
+#include "sink_registry.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace logging
+{
+
+SinkRegistry::SinkRegistry()
+    : mList(new SinkList{{CONSOLE_SINK, std::make_shared<ConsoleSink>()}})
+{
+}
+
+SinkRegistry::~SinkRegistry()
+{
+  delete mList.load();
+}
+
+SinkId SinkRegistry::Add(std::shared_ptr<Sink> sink)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  SinkList* list = new SinkList(*mList.load());
+  const SinkId id = mNextId++;
+  list->push_back({id, std::move(sink)});
+  Publish(list);
+
+  return id;
+}
+
+bool SinkRegistry::Remove(SinkId id)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  const SinkList* current = mList.load();
+  auto it = std::find_if(current->begin(), current->end(), [id](const Entry& e) { return e.id == id; });
+  if (it == current->end())
+    return false;
+
+  SinkList* list = new SinkList(*current);
+  list->erase(list->begin() + (it - current->begin()));
+  Publish(list);
+
+  return true;
+}
+
+void SinkRegistry::Clear()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  Publish(new SinkList());
+}
+
+void SinkRegistry::Publish(SinkList* list)
+{
+  const SinkList* old = mList.exchange(list);
+
+  // A reader still holding the old list has one of the two counters raised.
+  // Flip twice, each time waiting for the counter new readers no longer use.
+  for (int i = 0; i < 2; ++i)
+  {
+    const uint32_t epoch = mEpoch.fetch_add(1) & 1;
+    while (mReaders[epoch].load() != 0)
+      std::this_thread::yield();
+  }
+
+  delete old;
+}
+
+}  // namespace logging
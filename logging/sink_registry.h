@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "sinks.h"
+
+namespace logging
+{
+
+// Set of sinks records are dispatched to. The list is copied on every change
+// and published through an atomic pointer, so dispatching only takes a
+// snapshot and never locks. Old snapshots are freed once all readers that
+// could still see them are gone, tracked with two reader counters.
+class SinkRegistry
+{
+public:
+  struct Entry
+  {
+    SinkId id;
+    std::shared_ptr<Sink> sink;
+  };
+  using SinkList = std::vector<Entry>;
+
+  SinkRegistry();
+  ~SinkRegistry();
+
+  SinkRegistry(const SinkRegistry&) = delete;
+  SinkRegistry& operator=(const SinkRegistry&) = delete;
+
+  SinkId Add(std::shared_ptr<Sink> sink);
+  bool Remove(SinkId id);
+  void Clear();
+
+  // Calls f for every sink in the current snapshot. f must not add or remove sinks.
+  template <class F>
+  void ForEach(F&& f) const
+  {
+    const uint32_t epoch = mEpoch.load() & 1;
+    mReaders[epoch].fetch_add(1);
+
+    const SinkList* list = mList.load();
+    for (const Entry& entry : *list)
+      f(*entry.sink);
+
+    mReaders[epoch].fetch_sub(1);
+  }
+
+private:
+  void Publish(SinkList* list);
+
+  std::atomic<const SinkList*> mList;
+  std::atomic<uint32_t> mEpoch = 0;
+  mutable std::atomic<uint32_t> mReaders[2] = {0, 0};
+
+  // Serializes writers
+  std::mutex mMutex;
+  SinkId mNextId = CONSOLE_SINK + 1;
+};
+
+}  // namespace logging
@@ -0,0 +1,143 @@
+#include "sinks.h"
+
+#include <cstdio>
+
+namespace logging
+{
+
+void Sink::Flush()
+{
+}
+
+void Sink::Tick()
+{
+}
+
+void Sink::SetMinLevel(LogLevel level)
+{
+  mMinLevel.store(level, std::memory_order_relaxed);
+}
+
+LogLevel Sink::MinLevel() const
+{
+  return mMinLevel.load(std::memory_order_relaxed);
+}
+
+bool Sink::Accepts(LogLevel level) const
+{
+  return level <= MinLevel();
+}
+
+void Sink::SetFormatter(Formatter formatter)
+{
+  mFormatter = std::move(formatter);
+}
+
+void Sink::FormatRecord(std::string& out, const LogRecord& record, bool colored) const
+{
+  if (mFormatter)
+  {
+    mFormatter(out, record);
+  }
+  else if (!record.fields.empty())
+  {
+    std::string message = record.message;
+    AppendFieldsText(message, record.fields);
+    FormatLine(out, record.timestamp, record.level, record.filename, record.line, message, colored);
+  }
+  else
+  {
+    FormatLine(out, record.timestamp, record.level, record.filename, record.line, record.message, colored);
+  }
+}
+
+void ConsoleSink::Write(const LogRecord& record)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mLine.clear();
+  FormatRecord(mLine, record, true);
+
+  FILE* stream = record.level == LogLevel::Error ? stderr : stdout;
+  fwrite(mLine.data(), 1, mLine.size(), stream);
+  fflush(stream);
+}
+
+void ConsoleSink::Flush()
+{
+  fflush(stdout);
+  fflush(stderr);
+}
+
+CallbackSink::CallbackSink(Callback callback)
+    : mCallback(std::move(callback))
+{
+}
+
+void CallbackSink::Write(const LogRecord& record)
+{
+  if (mCallback)
+    mCallback(record.timestamp, record.level, std::string(record.filename), record.line, record.message);
+}
+
+MemorySink::MemorySink(size_t capacity)
+    : mCapacity(capacity)
+{
+}
+
+void MemorySink::Write(const LogRecord& record)
+{
+  std::string line;
+  FormatRecord(line, record, false);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mCapacity == 0)
+    return;
+
+  if (mLines.size() == mCapacity)
+    mLines.pop_front();
+
+  mLines.push_back(std::move(line));
+}
+
+std::vector<std::string> MemorySink::Lines() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return std::vector<std::string>(mLines.begin(), mLines.end());
+}
+
+void MemorySink::Clear()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mLines.clear();
+}
+
+FilterSink::FilterSink(std::shared_ptr<Sink> target, std::shared_ptr<const MultiPatternMatcher> matcher, FilterMode mode)
+    : mTarget(std::move(target))
+    , mMatcher(std::move(matcher))
+    , mMode(mode)
+{
+}
+
+void FilterSink::Write(const LogRecord& record)
+{
+  if (mTarget->Accepts(record.level) && mMatcher->Contains(record.message) == (mMode == FilterMode::Keep))
+    mTarget->Write(record);
+}
+
+void FilterSink::Flush()
+{
+  mTarget->Flush();
+}
+
+CallbackSink::Callback FilterCallback(std::shared_ptr<const MultiPatternMatcher> matcher, FilterMode mode,
+                                      CallbackSink::Callback callback)
+{
+  return [matcher = std::move(matcher), mode, callback = std::move(callback)](
+             std::chrono::system_clock::time_point now, LogLevel level, const std::string& filename,
+             const uint32_t& line, const std::string& message) {
+    if (matcher->Contains(message) == (mode == FilterMode::Keep))
+      callback(now, level, filename, line, message);
+  };
+}
+
+}  // namespace logging
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "logging.h"
+#include "multi_pattern_matcher.h"
+
+namespace logging
+{
+
+// Renders a record into out, the default is FormatLine
+using Formatter = std::function<void(std::string& out, const LogRecord& record)>;
+
+// Destination for log records. Sinks can be written to from several threads
+// at once (every caller thread in sync mode), so Write must be thread safe.
+class Sink
+{
+public:
+  virtual ~Sink() = default;
+
+  virtual void Write(const LogRecord& record) = 0;
+  virtual void Flush();
+  // Called by the async writer whenever it is idle, for time based work like flushing
+  // after an interval
+  virtual void Tick();
+
+  void SetMinLevel(LogLevel level);
+  LogLevel MinLevel() const;
+  bool Accepts(LogLevel level) const;
+
+  // Not synchronized with Write, set it before adding the sink
+  void SetFormatter(Formatter formatter);
+
+protected:
+  void FormatRecord(std::string& out, const LogRecord& record, bool colored) const;
+
+private:
+  std::atomic<LogLevel> mMinLevel = LogLevel::Trace;
+  Formatter mFormatter;
+};
+
+// Colored lines to stdout, errors to stderr. Registered by default.
+class ConsoleSink : public Sink
+{
+public:
+  void Write(const LogRecord& record) override;
+  void Flush() override;
+
+private:
+  std::mutex mMutex;
+  std::string mLine;
+};
+
+// Forwards records to a user function with the gLogToStream signature
+class CallbackSink : public Sink
+{
+public:
+  using Callback = std::function<void(std::chrono::system_clock::time_point now, LogLevel level,
+                                      const std::string& filename, const uint32_t& line,
+                                      const std::string& message)>;
+
+  explicit CallbackSink(Callback callback);
+
+  void Write(const LogRecord& record) override;
+
+private:
+  Callback mCallback;
+};
+
+// Keeps the last formatted lines in memory
+class MemorySink : public Sink
+{
+public:
+  explicit MemorySink(size_t capacity);
+
+  void Write(const LogRecord& record) override;
+
+  std::vector<std::string> Lines() const;
+  void Clear();
+
+private:
+  const size_t mCapacity;
+  mutable std::mutex mMutex;
+  std::deque<std::string> mLines;
+};
+
+enum class FilterMode
+{
+  // Only records whose message contains one of the patterns
+  Keep,
+  // Only records whose message contains none of the patterns
+  Drop
+};
+
+// Forwards records to another sink depending on the patterns found in their message.
+// All patterns are checked in a single pass over the message.
+//   auto matcher = std::make_shared<MultiPatternMatcher>(std::vector<std::string>{"timeout", "refused"});
+//   logging::AddSink(std::make_shared<logging::FilterSink>(fileSink, matcher, logging::FilterMode::Keep));
+class FilterSink : public Sink
+{
+public:
+  FilterSink(std::shared_ptr<Sink> target, std::shared_ptr<const MultiPatternMatcher> matcher, FilterMode mode);
+
+  void Write(const LogRecord& record) override;
+  void Flush() override;
+
+private:
+  std::shared_ptr<Sink> mTarget;
+  std::shared_ptr<const MultiPatternMatcher> mMatcher;
+  FilterMode mMode;
+};
+
+// Same filter for a gLogToStream callback:
+//   logging::gLogToStream = logging::FilterCallback(matcher, FilterMode::Drop, callback);
+CallbackSink::Callback FilterCallback(std::shared_ptr<const MultiPatternMatcher> matcher, FilterMode mode,
+                                      CallbackSink::Callback callback);
+
+}  // namespace logging
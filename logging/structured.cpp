@@ -0,0 +1,314 @@
+#include "structured.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "logging.h"
+#include "numbers.h"
+
+namespace logging
+{
+
+namespace
+{
+
+constexpr uint8_t BINARY_VERSION = 1;
+
+const char* LevelName(LogLevel level)
+{
+  switch (level)
+  {
+    case LogLevel::Error:
+      return "error";
+    case LogLevel::Warning:
+      return "warning";
+    case LogLevel::Info:
+      return "info";
+    case LogLevel::Debugging:
+      return "debug";
+    case LogLevel::Trace:
+      return "trace";
+    default:
+      return "unknown";
+  }
+}
+
+void AppendJsonString(std::string& out, std::string_view value)
+{
+  static const char HEX[] = "0123456789abcdef";
+
+  out += '"';
+  size_t run = 0;
+  for (size_t i = 0; i < value.size(); ++i)
+  {
+    const unsigned char c = static_cast<unsigned char>(value[i]);
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+
+    out.append(value.data() + run, i - run);
+    run = i + 1;
+    switch (c)
+    {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        out += "\\u00";
+        out += HEX[c >> 4];
+        out += HEX[c & 0xf];
+        break;
+    }
+  }
+  out.append(value.data() + run, value.size() - run);
+  out += '"';
+}
+
+void AppendJsonValue(std::string& out, const LogField::Value& value)
+{
+  std::visit(
+      [&out](const auto& v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, bool>)
+          out += v ? "true" : "false";
+        else if constexpr (std::is_same_v<T, std::string>)
+          AppendJsonString(out, v);
+        else if constexpr (std::is_same_v<T, double>)
+        {
+          // JSON has no NaN or infinity
+          if (std::isfinite(v))
+            AppendNumber(out, v);
+          else
+            out += "null";
+        }
+        else
+          AppendNumber(out, v);
+      },
+      value);
+}
+
+template <class T>
+void PutLittleEndian(std::string& out, T value)
+{
+  uint64_t v;
+  if constexpr (std::is_same_v<T, double>)
+    memcpy(&v, &value, sizeof(v));
+  else
+    v = static_cast<uint64_t>(value);
+
+  for (size_t i = 0; i < sizeof(T); ++i)
+    out += static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+template <class T>
+bool GetLittleEndian(std::string_view& in, T& value)
+{
+  if (in.size() < sizeof(T))
+    return false;
+
+  uint64_t v = 0;
+  for (size_t i = 0; i < sizeof(T); ++i)
+    v |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+  in.remove_prefix(sizeof(T));
+
+  if constexpr (std::is_same_v<T, double>)
+    memcpy(&value, &v, sizeof(value));
+  else
+    value = static_cast<T>(v);
+  return true;
+}
+
+template <class L>
+void PutString(std::string& out, std::string_view value)
+{
+  const L len = static_cast<L>(std::min<size_t>(value.size(), static_cast<L>(-1)));
+  PutLittleEndian(out, len);
+  out.append(value.data(), len);
+}
+
+template <class L>
+bool GetString(std::string_view& in, std::string& value)
+{
+  L len;
+  if (!GetLittleEndian(in, len) || in.size() < len)
+    return false;
+
+  value.assign(in.data(), len);
+  in.remove_prefix(len);
+  return true;
+}
+
+}  // namespace
+
+void AppendFieldsText(std::string& out, const LogFields& fields)
+{
+  for (const LogField& field : fields)
+  {
+    out += ' ';
+    out += field.key;
+    out += '=';
+    std::visit(
+        [&out](const auto& v) {
+          using T = std::decay_t<decltype(v)>;
+          if constexpr (std::is_same_v<T, bool>)
+            out += v ? "true" : "false";
+          else if constexpr (std::is_same_v<T, std::string>)
+            out += v;
+          else
+            AppendNumber(out, v);
+        },
+        field.value);
+  }
+}
+
+void FormatJsonLine(std::string& out, const LogRecord& record)
+{
+  out += "{\"ts\":";
+  AppendNumber(out, std::chrono::duration_cast<std::chrono::microseconds>(record.timestamp.time_since_epoch()).count());
+  out += ",\"level\":\"";
+  out += LevelName(record.level);
+  out += "\",\"file\":";
+  AppendJsonString(out, record.filename);
+  out += ",\"line\":";
+  AppendNumber(out, record.line);
+  out += ",\"msg\":";
+  AppendJsonString(out, record.message);
+
+  for (const LogField& field : record.fields)
+  {
+    out += ',';
+    AppendJsonString(out, field.key);
+    out += ':';
+    AppendJsonValue(out, field.value);
+  }
+  out += "}\n";
+}
+
+void FormatBinary(std::string& out, const LogRecord& record)
+{
+  const size_t start = out.size();
+  PutLittleEndian<uint32_t>(out, 0);
+
+  PutLittleEndian<uint8_t>(out, BINARY_VERSION);
+  PutLittleEndian<int64_t>(out, std::chrono::duration_cast<std::chrono::microseconds>(record.timestamp.time_since_epoch()).count());
+  PutLittleEndian<uint8_t>(out, static_cast<uint8_t>(record.level));
+  PutLittleEndian<uint32_t>(out, record.line);
+  PutString<uint16_t>(out, record.filename);
+  PutString<uint32_t>(out, record.message);
+
+  const uint16_t count = static_cast<uint16_t>(std::min<size_t>(record.fields.size(), UINT16_MAX));
+  PutLittleEndian(out, count);
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    const LogField& field = record.fields[i];
+    PutString<uint16_t>(out, field.key);
+    PutLittleEndian<uint8_t>(out, static_cast<uint8_t>(field.value.index()));
+    std::visit(
+        [&out](const auto& v) {
+          using T = std::decay_t<decltype(v)>;
+          if constexpr (std::is_same_v<T, bool>)
+            PutLittleEndian<uint8_t>(out, v ? 1 : 0);
+          else if constexpr (std::is_same_v<T, std::string>)
+            PutString<uint32_t>(out, v);
+          else
+            PutLittleEndian(out, v);
+        },
+        field.value);
+  }
+
+  // Patch in the size now that it is known
+  std::string size;
+  PutLittleEndian<uint32_t>(size, static_cast<uint32_t>(out.size() - start - sizeof(uint32_t)));
+  out.replace(start, sizeof(uint32_t), size);
+}
+
+bool DecodeBinary(std::string_view& in, LogRecord& record, StringPool& filenames)
+{
+  std::string_view cursor = in;
+  uint32_t size;
+  if (!GetLittleEndian(cursor, size) || cursor.size() < size)
+    return false;
+
+  std::string_view body = cursor.substr(0, size);
+  std::string filename;
+  uint8_t version, level;
+  int64_t micros;
+  uint16_t count;
+  if (!GetLittleEndian(body, version) || version != BINARY_VERSION || !GetLittleEndian(body, micros) ||
+      !GetLittleEndian(body, level) || !GetLittleEndian(body, record.line) ||
+      !GetString<uint16_t>(body, filename) || !GetString<uint32_t>(body, record.message) ||
+      !GetLittleEndian(body, count))
+    return false;
+
+  record.timestamp = std::chrono::system_clock::time_point(std::chrono::microseconds(micros));
+  record.level = static_cast<LogLevel>(level);
+  record.filename = filenames.Intern(filename);
+  record.format = nullptr;
+  record.fields.clear();
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    std::string key;
+    uint8_t type;
+    if (!GetString<uint16_t>(body, key) || !GetLittleEndian(body, type))
+      return false;
+
+    bool ok = false;
+    switch (type)
+    {
+      case 0:
+      {
+        int64_t v = 0;
+        ok = GetLittleEndian(body, v);
+        record.fields.emplace_back(key, v);
+        break;
+      }
+      case 1:
+      {
+        uint64_t v = 0;
+        ok = GetLittleEndian(body, v);
+        record.fields.emplace_back(key, v);
+        break;
+      }
+      case 2:
+      {
+        double v = 0;
+        ok = GetLittleEndian(body, v);
+        record.fields.emplace_back(key, v);
+        break;
+      }
+      case 3:
+      {
+        uint8_t v = 0;
+        ok = GetLittleEndian(body, v);
+        record.fields.emplace_back(key, v != 0);
+        break;
+      }
+      case 4:
+      {
+        std::string v;
+        ok = GetString<uint32_t>(body, v);
+        record.fields.emplace_back(key, v);
+        break;
+      }
+    }
+
+    if (!ok)
+      return false;
+  }
+
+  in = cursor.substr(size);
+  return true;
+}
+
+}  // namespace logging
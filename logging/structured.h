@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+class StringPool;
+
+namespace logging
+{
+
+struct LogRecord;
+
+// Typed key/value pair attached to a record
+struct LogField
+{
+  using Value = std::variant<int64_t, uint64_t, double, bool, std::string>;
+
+  template <class T>
+  LogField(std::string_view k, const T& v)
+      : key(k)
+      , value(ToValue(v))
+  {
+  }
+
+  std::string key;
+  Value value;
+
+private:
+  template <class T>
+  static Value ToValue(const T& v)
+  {
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same_v<D, bool>)
+      return v;
+    else if constexpr (std::is_enum_v<D>)
+      return static_cast<int64_t>(v);
+    else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>)
+      return static_cast<int64_t>(v);
+    else if constexpr (std::is_integral_v<D>)
+      return static_cast<uint64_t>(v);
+    else if constexpr (std::is_floating_point_v<D>)
+      return static_cast<double>(v);
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+      return std::string(std::string_view(v));
+    else
+      static_assert(!sizeof(D), "Unsupported log field type");
+  }
+};
+
+using LogFields = std::vector<LogField>;
+
+// Appends " key=value" for every field, used by the plain text line format
+void AppendFieldsText(std::string& out, const LogFields& fields);
+
+// Formatters (see Sink::SetFormatter) that encode records without printf formatting.
+// One JSON object per line:
+//   {"ts":1682599031976681,"level":"info","file":"main","line":22,"msg":"...","user":42}
+void FormatJsonLine(std::string& out, const LogRecord& record);
+
+// Length prefixed binary record, all integers little endian:
+//   u32 size of the rest | u8 version | i64 timestamp (us since epoch) | u8 level | u32 line
+//   u16 + filename | u32 + message | u16 field count
+//   per field: u16 + key | u8 type (0 int64, 1 uint64, 2 double, 3 bool, 4 string) | value
+// Strings are length prefixed, bools take one byte.
+void FormatBinary(std::string& out, const LogRecord& record);
+
+// Decodes one FormatBinary record from the front of in and advances it.
+// Returns false, leaving in untouched, if it does not start with a complete record.
+// record.filename is interned in filenames, so it stays valid as long as that pool.
+// Use a pool per decoder, files from elsewhere would grow StringPool::Global() forever.
+bool DecodeBinary(std::string_view& in, LogRecord& record, StringPool& filenames);
+
+}  // namespace logging
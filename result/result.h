@@ -5,13 +5,14 @@
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 template <class T>
 class Result
 {
 public:
   Result(T data)
-      : mData(data)
+      : mData(std::move(data))
   {
   }
 
@@ -0,0 +1,335 @@
+#include "format.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+// Output into a fixed buffer. Keeps counting past the end so the caller learns
+// the size the full output needs.
+class Output
+{
+public:
+  Output(char* buffer, size_t size)
+      : mBuffer(buffer)
+      , mSize(size)
+  {
+  }
+
+  void Append(const char* data, size_t size)
+  {
+    if (mLength + 1 < mSize)
+      memcpy(mBuffer + mLength, data, std::min(size, mSize - mLength - 1));
+    mLength += size;
+  }
+
+  template <class... T>
+  void AppendFormatted(const char* spec, T... values)
+  {
+    const bool room = mLength + 1 < mSize;
+    int len = snprintf(room ? mBuffer + mLength : nullptr, room ? mSize - mLength : 0, spec, values...);
+    if (len > 0)
+      mLength += len;
+  }
+
+  size_t Finish()
+  {
+    if (mSize)
+      mBuffer[std::min(mLength, mSize - 1)] = '\0';
+    return mLength;
+  }
+
+private:
+  char* mBuffer;
+  size_t mSize;
+  size_t mLength = 0;
+};
+
+// Parsed conversion spec, rebuilt with a length modifier matching the argument
+struct Spec
+{
+  char flags[8] = {};
+  size_t flagCount = 0;
+  bool hasWidth = false;
+  int width = 0;
+  bool hasPrecision = false;
+  int precision = 0;
+
+  template <class T>
+  void Emit(Output& out, const char* suffix, T value) const
+  {
+    char text[24] = "%";
+    size_t len = 1;
+    for (size_t i = 0; i < flagCount; ++i)
+      text[len++] = flags[i];
+    if (hasWidth)
+      text[len++] = '*';
+    if (hasPrecision)
+    {
+      text[len++] = '.';
+      text[len++] = '*';
+    }
+    while (*suffix)
+      text[len++] = *suffix++;
+    text[len] = '\0';
+
+    if (hasWidth && hasPrecision)
+      out.AppendFormatted(text, width, precision, value);
+    else if (hasWidth)
+      out.AppendFormatted(text, width, value);
+    else if (hasPrecision)
+      out.AppendFormatted(text, precision, value);
+    else
+      out.AppendFormatted(text, value);
+  }
+
+  void EmitString(Output& out, std::string_view value) const
+  {
+    // The string does not have to be 0 terminated, so the precision always bounds it
+    Spec bounded = *this;
+    const int size = static_cast<int>(std::min<size_t>(value.size(), INT32_MAX));
+    bounded.precision = hasPrecision && precision >= 0 ? std::min(precision, size) : size;
+    bounded.hasPrecision = true;
+    bounded.Emit(out, "s", value.data());
+  }
+};
+
+int ReadNumber(const char*& p)
+{
+  int value = 0;
+  while (*p >= '0' && *p <= '9')
+  {
+    value = std::min(value * 10 + (*p - '0'), 1 << 20);
+    ++p;
+  }
+  return value;
+}
+
+int64_t AsInt(const FormatArg& arg)
+{
+  switch (arg.type)
+  {
+    case FormatArgType::UInt:
+      return static_cast<int64_t>(arg.u);
+    case FormatArgType::Double:
+      return static_cast<int64_t>(arg.d);
+    case FormatArgType::Pointer:
+      return static_cast<int64_t>(reinterpret_cast<uintptr_t>(arg.p));
+    default:
+      return arg.i;
+  }
+}
+
+double AsDouble(const FormatArg& arg)
+{
+  switch (arg.type)
+  {
+    case FormatArgType::Int:
+      return static_cast<double>(arg.i);
+    case FormatArgType::UInt:
+      return static_cast<double>(arg.u);
+    default:
+      return arg.d;
+  }
+}
+
+const char* UnsignedSuffix(char conversion)
+{
+  switch (conversion)
+  {
+    case 'o':
+      return "llo";
+    case 'x':
+      return "llx";
+    case 'X':
+      return "llX";
+    default:
+      return "llu";
+  }
+}
+
+const char* FloatSuffix(char conversion)
+{
+  switch (conversion)
+  {
+    case 'e':
+      return "e";
+    case 'E':
+      return "E";
+    case 'F':
+      return "F";
+    case 'g':
+      return "g";
+    case 'G':
+      return "G";
+    case 'a':
+      return "a";
+    case 'A':
+      return "A";
+    default:
+      return "f";
+  }
+}
+
+}  // namespace
+
+size_t FormatArgsTo(char* buffer, size_t size, const char* format, const FormatArg* args, size_t count)
+{
+  Output out(buffer, size);
+  if (!format)
+    return out.Finish();
+
+  size_t argIndex = 0;
+  auto next = [&]() -> const FormatArg* { return argIndex < count ? &args[argIndex++] : nullptr; };
+
+  const char* p = format;
+  while (*p)
+  {
+    if (*p != '%')
+    {
+      const char* percent = strchr(p, '%');
+      const size_t len = percent ? static_cast<size_t>(percent - p) : strlen(p);
+      out.Append(p, len);
+      p += len;
+      continue;
+    }
+
+    if (p[1] == '%')
+    {
+      out.Append("%", 1);
+      p += 2;
+      continue;
+    }
+
+    const char* start = p++;
+    Spec spec;
+
+    while (*p && strchr("-+ #0'", *p))
+    {
+      if (spec.flagCount < sizeof(spec.flags))
+        spec.flags[spec.flagCount++] = *p;
+      ++p;
+    }
+
+    if (*p == '*')
+    {
+      const FormatArg* arg = next();
+      spec.hasWidth = arg != nullptr;
+      spec.width = arg ? static_cast<int>(AsInt(*arg)) : 0;
+      ++p;
+    }
+    else if (*p >= '0' && *p <= '9')
+    {
+      spec.hasWidth = true;
+      spec.width = ReadNumber(p);
+    }
+
+    if (*p == '.')
+    {
+      ++p;
+      spec.hasPrecision = true;
+      if (*p == '*')
+      {
+        const FormatArg* arg = next();
+        spec.precision = arg ? static_cast<int>(AsInt(*arg)) : 0;
+        ++p;
+      }
+      else
+      {
+        spec.precision = ReadNumber(p);
+      }
+    }
+
+    while (*p && strchr("hlLqjzt", *p))
+      ++p;
+
+    const char conversion = *p;
+    if (!conversion)
+    {
+      out.Append(start, strlen(start));
+      break;
+    }
+    ++p;
+
+    const FormatArg* arg = next();
+    if (!arg)
+    {
+      // More specifiers than arguments, keep the spec as text
+      out.Append(start, p - start);
+      continue;
+    }
+
+    switch (conversion)
+    {
+      case 'd':
+      case 'i':
+        if (arg->type == FormatArgType::String)
+          spec.EmitString(out, arg->s);
+        else if (arg->type == FormatArgType::UInt)
+          spec.Emit(out, "llu", static_cast<unsigned long long>(arg->u));
+        else
+          spec.Emit(out, "lld", static_cast<long long>(AsInt(*arg)));
+        break;
+      case 'o':
+      case 'u':
+      case 'x':
+      case 'X':
+        if (arg->type == FormatArgType::String)
+          spec.EmitString(out, arg->s);
+        else
+          spec.Emit(out, UnsignedSuffix(conversion), static_cast<unsigned long long>(AsInt(*arg)));
+        break;
+      case 'c':
+        spec.Emit(out, "c", static_cast<int>(AsInt(*arg)));
+        break;
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        spec.Emit(out, FloatSuffix(conversion), AsDouble(*arg));
+        break;
+      case 's':
+        if (arg->type == FormatArgType::String)
+          spec.EmitString(out, arg->s);
+        else if (arg->type == FormatArgType::Double)
+          spec.Emit(out, "g", arg->d);
+        else if (arg->type == FormatArgType::UInt)
+          spec.Emit(out, "llu", static_cast<unsigned long long>(arg->u));
+        else if (arg->type == FormatArgType::Pointer)
+          spec.Emit(out, "p", arg->p);
+        else
+          spec.Emit(out, "lld", static_cast<long long>(arg->i));
+        break;
+      case 'p':
+        spec.Emit(out, "p", arg->type == FormatArgType::String ? static_cast<const void*>(arg->s.data()) : arg->p);
+        break;
+      case 'n':
+        // Never write through an argument
+        break;
+      default:
+        out.Append(start, p - start);
+        break;
+    }
+  }
+
+  return out.Finish();
+}
+
+std::string FormatArgs(const char* format, const FormatArg* args, size_t count)
+{
+  // Most lines fit on the stack, larger ones are formatted a second time at their exact size
+  char buffer[256];
+  const size_t len = FormatArgsTo(buffer, sizeof(buffer), format, args, count);
+  if (len < sizeof(buffer))
+    return std::string(buffer, len);
+
+  std::string result(len, '\0');
+  FormatArgsTo(&result[0], len + 1, format, args, count);
+  return result;
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Type-safe printf style formatting. Arguments are passed as templates, so the
+// length modifiers of the format string do not matter ("%d" prints an int64_t
+// just fine) and std::string/std::string_view can be given to "%s" directly.
+
+enum class FormatArgType : uint8_t
+{
+  Int,
+  UInt,
+  Double,
+  String,
+  Pointer
+};
+
+// One argument, normalized to the widest type of its kind. Strings are not copied.
+struct FormatArg
+{
+  FormatArg() = default;
+
+  template <class T>
+  FormatArg(const T& value)
+  {
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same_v<D, bool>)
+      Set(FormatArgType::UInt, u, static_cast<uint64_t>(value));
+    else if constexpr (std::is_enum_v<D>)
+      Set(FormatArgType::Int, i, static_cast<int64_t>(value));
+    else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>)
+      Set(FormatArgType::Int, i, static_cast<int64_t>(value));
+    else if constexpr (std::is_integral_v<D>)
+      Set(FormatArgType::UInt, u, static_cast<uint64_t>(value));
+    else if constexpr (std::is_floating_point_v<D>)
+      Set(FormatArgType::Double, d, static_cast<double>(value));
+    else if constexpr (std::is_array_v<T> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>)
+      Set(FormatArgType::String, s, std::string_view(value));
+    else if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>)
+      Set(FormatArgType::String, s, value ? std::string_view(value) : std::string_view("(null)"));
+    else if constexpr (std::is_same_v<D, std::string> || std::is_same_v<D, std::string_view>)
+      Set(FormatArgType::String, s, std::string_view(value));
+    else if constexpr (std::is_pointer_v<D> || std::is_null_pointer_v<D>)
+      Set(FormatArgType::Pointer, p, static_cast<const void*>(value));
+    else
+      static_assert(!sizeof(D), "Unsupported format argument type");
+  }
+
+  FormatArgType type = FormatArgType::Int;
+  int64_t i = 0;
+  uint64_t u = 0;
+  double d = 0;
+  std::string_view s;
+  const void* p = nullptr;
+
+private:
+  template <class M, class V>
+  void Set(FormatArgType t, M& member, V value)
+  {
+    type = t;
+    member = value;
+  }
+};
+
+// Formats into buffer, truncating if needed, and always 0 terminates (if size > 0).
+// Like snprintf, returns the length of the full output so a caller can size a
+// larger buffer and call again.
+size_t FormatArgsTo(char* buffer, size_t size, const char* format, const FormatArg* args, size_t count);
+std::string FormatArgs(const char* format, const FormatArg* args, size_t count);
+
+template <class... Args>
+size_t FormatTo(char* buffer, size_t size, const char* format, const Args&... args)
+{
+  // The trailing element avoids a zero sized array
+  const FormatArg packed[] = {FormatArg(args)..., FormatArg()};
+  return FormatArgsTo(buffer, size, format, packed, sizeof...(Args));
+}
+
+// Formatted text kept inline when shorter than N, only longer outputs use the heap
+template <size_t N = 256>
+class FormatBuffer
+{
+public:
+  template <class... Args>
+  explicit FormatBuffer(const char* format, const Args&... args)
+  {
+    const FormatArg packed[] = {FormatArg(args)..., FormatArg()};
+    mSize = FormatArgsTo(mInline, N, format, packed, sizeof...(Args));
+    if (mSize >= N)
+    {
+      mHeap.reset(new char[mSize + 1]);
+      FormatArgsTo(mHeap.get(), mSize + 1, format, packed, sizeof...(Args));
+    }
+  }
+
+  FormatBuffer(const FormatBuffer&) = delete;
+  FormatBuffer& operator=(const FormatBuffer&) = delete;
+
+  // 0 terminated
+  const char* Data() const
+  {
+    return mHeap ? mHeap.get() : mInline;
+  }
+
+  size_t Size() const
+  {
+    return mSize;
+  }
+
+  std::string_view View() const
+  {
+    return std::string_view(Data(), mSize);
+  }
+
+  operator std::string_view() const
+  {
+    return View();
+  }
+
+private:
+  char mInline[N];
+  std::unique_ptr<char[]> mHeap;
+  size_t mSize = 0;
+};
+
+// Compile time validation of a literal format string against argument types,
+// used by the FORMAT macro
+namespace format_detail
+{
+
+enum class Category
+{
+  Integer,
+  Floating,
+  String,
+  Pointer
+};
+
+template <class T>
+constexpr Category CategoryOf()
+{
+  if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+    return Category::Integer;
+  else if constexpr (std::is_floating_point_v<T>)
+    return Category::Floating;
+  else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*> || std::is_same_v<T, std::string> ||
+                     std::is_same_v<T, std::string_view>)
+    return Category::String;
+  else
+    return Category::Pointer;
+}
+
+template <class... Args>
+struct TypeList
+{
+};
+
+template <class... Args>
+TypeList<std::decay_t<Args>...> ArgTypes(const Args&...);
+
+constexpr bool IsDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+constexpr bool IsOneOf(char c, std::string_view set)
+{
+  return set.find(c) != std::string_view::npos;
+}
+
+constexpr bool Accepts(char conversion, Category category)
+{
+  switch (conversion)
+  {
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'c':
+      return category == Category::Integer;
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      return category == Category::Integer || category == Category::Floating;
+    case 's':
+      return category == Category::String;
+    case 'p':
+      return category == Category::Pointer || category == Category::String;
+    default:
+      return false;
+  }
+}
+
+template <size_t COUNT>
+constexpr bool Validate(std::string_view format, const Category (&categories)[COUNT], size_t argCount)
+{
+  size_t arg = 0;
+  for (size_t pos = 0; pos < format.size(); ++pos)
+  {
+    if (format[pos] != '%')
+      continue;
+
+    if (++pos < format.size() && format[pos] == '%')
+      continue;
+
+    while (pos < format.size() && IsOneOf(format[pos], "-+ #0'"))
+      ++pos;
+
+    if (pos < format.size() && format[pos] == '*')
+    {
+      if (arg >= argCount || categories[arg++] != Category::Integer)
+        return false;
+      ++pos;
+    }
+    while (pos < format.size() && IsDigit(format[pos]))
+      ++pos;
+
+    if (pos < format.size() && format[pos] == '.')
+    {
+      ++pos;
+      if (pos < format.size() && format[pos] == '*')
+      {
+        if (arg >= argCount || categories[arg++] != Category::Integer)
+          return false;
+        ++pos;
+      }
+      while (pos < format.size() && IsDigit(format[pos]))
+        ++pos;
+    }
+
+    while (pos < format.size() && IsOneOf(format[pos], "hlLqjzt"))
+      ++pos;
+
+    if (pos >= format.size() || arg >= argCount || !Accepts(format[pos], categories[arg++]))
+      return false;
+  }
+
+  return arg == argCount;
+}
+
+template <class... Args>
+constexpr bool Validate(std::string_view format, TypeList<Args...>)
+{
+  // The trailing element avoids a zero sized array
+  constexpr Category categories[] = {CategoryOf<Args>()..., Category::Integer};
+  return Validate(format, categories, sizeof...(Args));
+}
+
+template <bool VALID>
+constexpr void Check()
+{
+  static_assert(VALID, "Format string does not match its arguments");
+}
+
+}  // namespace format_detail
+
+// Format() with the format string checked against the argument types at compile
+// time. The format must be a string literal.
+//   std::string s = FORMAT("%s has %d items", name, count);
+#define FORMAT(format, ...)                                                                                            \
+  (format_detail::Check<format_detail::Validate(format, decltype(format_detail::ArgTypes(__VA_ARGS__))())>(),         \
+   Format(format, ##__VA_ARGS__))
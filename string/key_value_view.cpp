@@ -0,0 +1,99 @@
+#include "key_value_view.h"
+
+#include <functional>
+
+#include "string_helpers.h"
+
+KeyValueView::KeyValueView(std::string_view str, char pairDelimiter, char keyDelimiter)
+{
+  Parse(str, pairDelimiter, keyDelimiter);
+}
+
+void KeyValueView::Parse(std::string_view str, char pairDelimiter, char keyDelimiter)
+{
+  Clear();
+
+  // Size the table once from an upper bound on the number of pairs
+  const size_t maxPairs = CountChar(str.data(), str.data() + str.size(), pairDelimiter) + 1;
+  size_t slots = 16;
+  while (slots < 2 * maxPairs)
+    slots *= 2;
+  mSlots.assign(slots, 0);
+  mEntries.reserve(maxPairs);
+
+  std::string_view key, value;
+  for (std::string_view pair : SplitView(str, pairDelimiter))
+  {
+    if (!SplitPair(pair, keyDelimiter, key, value))
+      continue;
+
+    uint32_t& slot = mSlots[Probe(key)];
+    if (slot)
+    {
+      mEntries[slot - 1].second = value;
+    }
+    else
+    {
+      mEntries.emplace_back(key, value);
+      slot = static_cast<uint32_t>(mEntries.size());
+    }
+  }
+}
+
+void KeyValueView::Clear()
+{
+  mEntries.clear();
+  mSlots.clear();
+}
+
+size_t KeyValueView::Probe(std::string_view key) const
+{
+  const size_t mask = mSlots.size() - 1;
+  for (size_t i = std::hash<std::string_view>()(key) & mask;; i = (i + 1) & mask)
+  {
+    if (!mSlots[i] || mEntries[mSlots[i] - 1].first == key)
+      return i;
+  }
+}
+
+std::optional<std::string_view> KeyValueView::Find(std::string_view key) const
+{
+  if (mSlots.empty())
+    return std::nullopt;
+
+  const uint32_t slot = mSlots[Probe(key)];
+  if (!slot)
+    return std::nullopt;
+
+  return mEntries[slot - 1].second;
+}
+
+bool KeyValueView::Contains(std::string_view key) const
+{
+  return Find(key).has_value();
+}
+
+std::string_view KeyValueView::Get(std::string_view key, std::string_view fallback) const
+{
+  return Find(key).value_or(fallback);
+}
+
+size_t KeyValueView::Size() const
+{
+  return mEntries.size();
+}
+
+bool KeyValueView::IsEmpty() const
+{
+  return mEntries.empty();
+}
+
+std::vector<KeyValueView::Entry>::const_iterator KeyValueView::begin() const
+{
+  return mEntries.begin();
+}
+
+std::vector<KeyValueView::Entry>::const_iterator KeyValueView::end() const
+{
+  return mEntries.end();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Key/value pairs parsed from "k1=v1;k2=v2" without copying: keys and values are
+// views into the parsed buffer, which must outlive them. Lookups go through an
+// open addressing hash table. Pairs follow the rules of Split(str, c1, c2), including
+// a later duplicate key replacing the earlier value.
+class KeyValueView
+{
+public:
+  using Entry = std::pair<std::string_view, std::string_view>;
+
+  KeyValueView() = default;
+  KeyValueView(std::string_view str, char pairDelimiter, char keyDelimiter);
+
+  // Replaces the content, reusing the storage of a previous parse
+  void Parse(std::string_view str, char pairDelimiter, char keyDelimiter);
+
+  // A temporary string would be gone before the views are used. Templates, so string
+  // literals still go to the string_view overloads.
+  template <class S, std::enable_if_t<std::is_same_v<S, std::string>, int> = 0>
+  KeyValueView(S&& str, char pairDelimiter, char keyDelimiter) = delete;
+  template <class S, std::enable_if_t<std::is_same_v<S, std::string>, int> = 0>
+  void Parse(S&& str, char pairDelimiter, char keyDelimiter) = delete;
+  void Clear();
+
+  std::optional<std::string_view> Find(std::string_view key) const;
+  bool Contains(std::string_view key) const;
+  std::string_view Get(std::string_view key, std::string_view fallback = {}) const;
+
+  size_t Size() const;
+  bool IsEmpty() const;
+
+  // Entries in order of the first occurrence of their key
+  std::vector<Entry>::const_iterator begin() const;
+  std::vector<Entry>::const_iterator end() const;
+
+private:
+  // Slot holding key, or the empty slot where it would go
+  size_t Probe(std::string_view key) const;
+
+  std::vector<Entry> mEntries;
+  // Index + 1 into mEntries, 0 for an empty slot. Power of two size, at most half full.
+  std::vector<uint32_t> mSlots;
+};
@@ -0,0 +1,162 @@
+#include "multi_pattern_matcher.h"
+
+#include <queue>
+
+#include "simd_scan.h"
+
+namespace
+{
+
+unsigned char Fold(unsigned char c, bool ignoreCase)
+{
+  return ignoreCase && c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+}
+
+}  // namespace
+
+MultiPatternMatcher::MultiPatternMatcher(const std::vector<std::string>& patterns, bool ignoreCase)
+    : mPatterns(patterns)
+{
+  // Give every byte used by a pattern its own column (both cases share one when ignoring case)
+  mClassCount = 1;
+  uint16_t folded[256] = {};
+  for (const std::string& pattern : mPatterns)
+  {
+    for (char c : pattern)
+    {
+      const unsigned char f = Fold(c, ignoreCase);
+      if (!folded[f])
+        folded[f] = static_cast<uint16_t>(mClassCount++);
+    }
+  }
+  for (size_t c = 0; c < 256; ++c)
+    mClasses[c] = folded[Fold(static_cast<unsigned char>(c), ignoreCase)];
+
+  auto addState = [this]() {
+    mTransitions.resize(mTransitions.size() + mClassCount, NONE);
+    mTerminal.push_back(NONE);
+    mOutputLink.push_back(NONE);
+    return static_cast<uint32_t>(mTerminal.size() - 1);
+  };
+
+  // Trie of the patterns
+  addState();
+  for (uint32_t index = 0; index < mPatterns.size(); ++index)
+  {
+    const std::string& pattern = mPatterns[index];
+    if (pattern.empty())
+      continue;
+
+    uint32_t state = 0;
+    for (char c : pattern)
+    {
+      uint32_t& next = mTransitions[state * mClassCount + mClasses[static_cast<unsigned char>(c)]];
+      if (next == NONE)
+      {
+        const uint32_t created = addState();
+        // addState() may have moved the table
+        mTransitions[state * mClassCount + mClasses[static_cast<unsigned char>(c)]] = created;
+        state = created;
+      }
+      else
+      {
+        state = next;
+      }
+    }
+
+    if (mTerminal[state] == NONE)
+      mTerminal[state] = index;
+  }
+
+  // Breadth first, turn the trie into a complete DFA: missing transitions take the
+  // transition of the failure state, which is shallower and therefore already complete
+  std::vector<uint32_t> failure(mTerminal.size(), 0);
+  std::queue<uint32_t> pending;
+  for (uint32_t c = 0; c < mClassCount; ++c)
+  {
+    uint32_t& next = mTransitions[c];
+    if (next == NONE)
+      next = 0;
+    else
+      pending.push(next);
+  }
+
+  while (!pending.empty())
+  {
+    const uint32_t state = pending.front();
+    pending.pop();
+
+    const uint32_t fail = failure[state];
+    mOutputLink[state] = mTerminal[fail] != NONE ? fail : mOutputLink[fail];
+
+    for (uint32_t c = 0; c < mClassCount; ++c)
+    {
+      uint32_t& next = mTransitions[state * mClassCount + c];
+      if (next == NONE)
+      {
+        next = mTransitions[fail * mClassCount + c];
+      }
+      else
+      {
+        failure[next] = mTransitions[fail * mClassCount + c];
+        pending.push(next);
+      }
+    }
+  }
+}
+
+size_t MultiPatternMatcher::PatternCount() const
+{
+  return mPatterns.size();
+}
+
+const std::string& MultiPatternMatcher::Pattern(uint32_t index) const
+{
+  return mPatterns[index];
+}
+
+bool MultiPatternMatcher::Contains(std::string_view text) const
+{
+  bool found = false;
+  Scan(text, [&found](const Match&) {
+    found = true;
+    return false;
+  });
+  return found;
+}
+
+void MultiPatternMatcher::FindAll(std::string_view text, std::vector<Match>& matches) const
+{
+  matches.clear();
+  Scan(text, [&matches](const Match& match) {
+    matches.push_back(match);
+    return true;
+  });
+}
+
+void MultiPatternMatcher::FindLines(std::string_view text, std::vector<std::string_view>& lines) const
+{
+  lines.clear();
+
+  const char* const end = text.data() + text.size();
+  while (!text.empty())
+  {
+    // Scan up to the first match, then resume after the line holding it
+    size_t position = std::string_view::npos;
+    Scan(text, [&position](const Match& match) {
+      position = match.position;
+      return false;
+    });
+    if (position == std::string_view::npos)
+      break;
+
+    const char* match = text.data() + position;
+    const char* lineStart = match;
+    while (lineStart > text.data() && lineStart[-1] != '\n')
+      --lineStart;
+    const char* lineEnd = FindChar(match, end, '\n');
+
+    lines.emplace_back(lineStart, lineEnd - lineStart);
+    text = lineEnd == end ? std::string_view() : std::string_view(lineEnd + 1, end - lineEnd - 1);
+  }
+}
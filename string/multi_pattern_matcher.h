@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Finds any number of patterns in a single pass over a buffer (Aho-Corasick). The
+// patterns are compiled once into a state machine over the bytes they use, after
+// which a scan costs one table lookup per byte, however many patterns there are.
+// Build once, then scan from any number of threads.
+class MultiPatternMatcher
+{
+public:
+  struct Match
+  {
+    // Offset of the first character of the match
+    size_t position;
+    // Index into the patterns given to the constructor
+    uint32_t pattern;
+  };
+
+  MultiPatternMatcher() = default;
+  // Empty patterns are ignored, duplicates are reported with the lowest index
+  explicit MultiPatternMatcher(const std::vector<std::string>& patterns, bool ignoreCase = false);
+
+  size_t PatternCount() const;
+  const std::string& Pattern(uint32_t index) const;
+
+  // Calls onMatch(const Match&) for every occurrence of every pattern, overlapping ones
+  // included, ordered by end position. Scanning stops when onMatch returns false.
+  template <class F>
+  void Scan(std::string_view text, F&& onMatch) const
+  {
+    if (mTransitions.empty())
+      return;
+
+    uint32_t state = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+      state = mTransitions[state * mClassCount + mClasses[static_cast<unsigned char>(text[i])]];
+      for (uint32_t s = mTerminal[state] != NONE ? state : mOutputLink[state]; s != NONE; s = mOutputLink[s])
+      {
+        const uint32_t pattern = mTerminal[s];
+        const Match match{i + 1 - mPatterns[pattern].size(), pattern};
+        if (!onMatch(match))
+          return;
+      }
+    }
+  }
+
+  bool Contains(std::string_view text) const;
+  // Fills matches (cleared first) with every match in text
+  void FindAll(std::string_view text, std::vector<Match>& matches) const;
+  // Fills lines (cleared first) with the '\n' separated lines of text containing a match
+  void FindLines(std::string_view text, std::vector<std::string_view>& lines) const;
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  std::vector<std::string> mPatterns;
+  // Byte -> column of the transition table, every byte not used by a pattern shares column 0
+  uint16_t mClasses[256] = {};
+  uint32_t mClassCount = 0;
+  // Complete DFA, mClassCount entries per state, state 0 is the root
+  std::vector<uint32_t> mTransitions;
+  // Pattern ending in a state, or NONE
+  std::vector<uint32_t> mTerminal;
+  // Closest state on the failure chain with a pattern ending in it, or NONE
+  std::vector<uint32_t> mOutputLink;
+};
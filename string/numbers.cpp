@@ -0,0 +1,38 @@
+#include "numbers.h"
+
+#include <algorithm>
+
+void AppendHex(std::string& out, uint64_t value, bool prefix)
+{
+  if (prefix)
+    out += "0x";
+
+  const size_t size = out.size();
+  out.resize(size + 16);
+  auto [end, ec] = std::to_chars(&out[size], &out[0] + out.size(), value, 16);
+  out.resize(end - out.data());
+}
+
+void AppendFixed(std::string& out, double value, int precision)
+{
+  // Up to 309 integer digits for the largest doubles
+  precision = std::max(precision, 0);
+  const size_t size = out.size();
+  out.resize(size + 320 + precision);
+  auto [end, ec] = std::to_chars(&out[size], &out[0] + out.size(), value, std::chars_format::fixed, precision);
+  out.resize(ec == std::errc() ? end - out.data() : size);
+}
+
+bool ParseHex(std::string_view str, uint64_t& value)
+{
+  if (str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+    str.remove_prefix(2);
+
+  uint64_t parsed;
+  auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), parsed, 16);
+  if (ec != std::errc() || end != str.data() + str.size())
+    return false;
+
+  value = parsed;
+  return true;
+}
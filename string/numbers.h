@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <charconv>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Locale independent number <-> text conversion on top of std::to_chars/from_chars.
+// The Append* functions write straight into the end of an existing string.
+
+// Upper bound of the characters to_chars writes for a T
+template <class T>
+constexpr size_t MaxNumberChars()
+{
+  if constexpr (std::is_floating_point_v<T>)
+    return 32;  // "-1.7976931348623157e+308" and friends
+  else
+    return std::numeric_limits<T>::digits10 + 3;  // digits, one more for a partial digit and the sign
+}
+
+// Decimal for integers, shortest round-trip representation for floats
+template <class T>
+void AppendNumber(std::string& out, T value)
+{
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "AppendNumber needs a number");
+  const size_t size = out.size();
+  out.resize(size + MaxNumberChars<T>());
+  auto [end, ec] = std::to_chars(&out[size], &out[0] + out.size(), value);
+  out.resize(end - out.data());
+}
+
+// Lower case hex, "0x" prefixed unless prefix is false
+void AppendHex(std::string& out, uint64_t value, bool prefix = true);
+
+// Fixed notation with the given number of decimals
+void AppendFixed(std::string& out, double value, int precision);
+
+// Parses the whole of str as a decimal number (no leading spaces or '+').
+// Returns false, leaving value untouched, on a syntax error or overflow.
+template <class T>
+bool ParseNumber(std::string_view str, T& value)
+{
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "ParseNumber needs a number");
+  T parsed;
+  auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), parsed);
+  if (ec != std::errc() || end != str.data() + str.size())
+    return false;
+
+  value = parsed;
+  return true;
+}
+
+// Parses hex digits, with or without a "0x"/"0X" prefix
+bool ParseHex(std::string_view str, uint64_t& value);
+
+// Joins values with separator, growing out once for the whole batch
+template <class T>
+void AppendJoined(std::string& out, const std::vector<T>& values, std::string_view separator = ", ")
+{
+  if (values.empty())
+    return;
+
+  const size_t start = out.size();
+  out.resize(start + values.size() * (MaxNumberChars<T>() + separator.size()));
+
+  char* cursor = &out[start];
+  char* const last = &out[0] + out.size();
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    if (i)
+    {
+      separator.copy(cursor, separator.size());
+      cursor += separator.size();
+    }
+    cursor = std::to_chars(cursor, last, values[i]).ptr;
+  }
+  out.resize(cursor - out.data());
+}
+
+template <class T>
+std::string Join(const std::vector<T>& values, std::string_view separator = ", ")
+{
+  std::string out;
+  AppendJoined(out, values, separator);
+  return out;
+}
@@ -0,0 +1,400 @@
+#include "simd_scan.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CPPHELPERS_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+// Sets larger than this use the scalar lookup table
+constexpr size_t MAX_SIMD_SET = 16;
+
+struct ScanKernels
+{
+  const char* name;
+  size_t (*countChar)(const char*, const char*, char);
+  const char* (*findFirstNotOf)(const char*, const char*, std::string_view);
+  const char* (*findLastNotOf)(const char*, const char*, std::string_view);
+  void (*toLower)(char*, char*);
+  void (*toUpper)(char*, char*);
+  int (*compareIgnoreCase)(const char*, const char*, size_t);
+};
+
+// ------------------------------------------------------------------------------------------------------------
+// Scalar
+
+class CharSet
+{
+public:
+  explicit CharSet(std::string_view set)
+  {
+    for (char c : set)
+      mBits[static_cast<unsigned char>(c) >> 6] |= uint64_t(1) << (c & 63);
+  }
+
+  bool Contains(char c) const
+  {
+    return mBits[static_cast<unsigned char>(c) >> 6] & (uint64_t(1) << (c & 63));
+  }
+
+private:
+  uint64_t mBits[4] = {};
+};
+
+size_t ScalarCountChar(const char* begin, const char* end, char c)
+{
+  return std::count(begin, end, c);
+}
+
+const char* ScalarFindFirstNotOf(const char* begin, const char* end, std::string_view set)
+{
+  const CharSet chars(set);
+  while (begin < end && chars.Contains(*begin))
+    ++begin;
+  return begin;
+}
+
+const char* ScalarFindLastNotOf(const char* begin, const char* end, std::string_view set)
+{
+  const CharSet chars(set);
+  while (end > begin && chars.Contains(end[-1]))
+    --end;
+  return end;
+}
+
+// Flips the case of c if it is in [first, first + 25], i.e. an ASCII letter of the other case
+inline char FlipCase(char c, char first)
+{
+  return static_cast<unsigned char>(c - first) < 26 ? c ^ 0x20 : c;
+}
+
+#ifndef CPPHELPERS_SIMD_X86
+// The SIMD versions handle their tails with FlipCase directly
+void ScalarToLower(char* begin, char* end)
+{
+  for (; begin < end; ++begin)
+    *begin = FlipCase(*begin, 'A');
+}
+
+void ScalarToUpper(char* begin, char* end)
+{
+  for (; begin < end; ++begin)
+    *begin = FlipCase(*begin, 'a');
+}
+#endif
+
+int ScalarCompareIgnoreCase(const char* a, const char* b, size_t size)
+{
+  for (size_t i = 0; i < size; ++i)
+  {
+    const unsigned char ca = FlipCase(a[i], 'A');
+    const unsigned char cb = FlipCase(b[i], 'A');
+    if (ca != cb)
+      return ca < cb ? -1 : 1;
+  }
+  return 0;
+}
+
+#ifdef CPPHELPERS_SIMD_X86
+
+// ------------------------------------------------------------------------------------------------------------
+// SSE2, always available on x86-64
+
+size_t Sse2CountChar(const char* begin, const char* end, char c)
+{
+  const __m128i needle = _mm_set1_epi8(c);
+  const char* p = begin;
+  size_t count = 0;
+  while (end - p >= 16)
+  {
+    // Per byte counters (cmpeq gives -1 on a match) flushed before they can overflow
+    __m128i counters = _mm_setzero_si128();
+    for (int i = 0; i < 255 && end - p >= 16; ++i, p += 16)
+    {
+      const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block, needle));
+    }
+
+    const __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+    count += _mm_cvtsi128_si64(sums) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+  }
+  return count + ScalarCountChar(p, end, c);
+}
+
+// Bit i set when byte i of the block is not part of the set
+inline uint32_t Sse2NotInSet(const char* p, const __m128i* set, size_t setSize)
+{
+  const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i in = _mm_setzero_si128();
+  for (size_t i = 0; i < setSize; ++i)
+    in = _mm_or_si128(in, _mm_cmpeq_epi8(block, set[i]));
+  return ~_mm_movemask_epi8(in) & 0xffff;
+}
+
+const char* Sse2FindFirstNotOf(const char* begin, const char* end, std::string_view set)
+{
+  if (set.size() > MAX_SIMD_SET)
+    return ScalarFindFirstNotOf(begin, end, set);
+
+  __m128i chars[MAX_SIMD_SET];
+  for (size_t i = 0; i < set.size(); ++i)
+    chars[i] = _mm_set1_epi8(set[i]);
+
+  const char* p = begin;
+  for (; end - p >= 16; p += 16)
+  {
+    const uint32_t mask = Sse2NotInSet(p, chars, set.size());
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return ScalarFindFirstNotOf(p, end, set);
+}
+
+const char* Sse2FindLastNotOf(const char* begin, const char* end, std::string_view set)
+{
+  if (set.size() > MAX_SIMD_SET)
+    return ScalarFindLastNotOf(begin, end, set);
+
+  __m128i chars[MAX_SIMD_SET];
+  for (size_t i = 0; i < set.size(); ++i)
+    chars[i] = _mm_set1_epi8(set[i]);
+
+  const char* p = end;
+  for (; p - begin >= 16; p -= 16)
+  {
+    const uint32_t mask = Sse2NotInSet(p - 16, chars, set.size());
+    if (mask)
+      return p - 16 + (32 - __builtin_clz(mask));
+  }
+  return ScalarFindLastNotOf(begin, p, set);
+}
+
+// Bytes in [first, first + 25] get their 0x20 bit flipped. Adding 128 - first moves that
+// range to the bottom of the signed range, so a single signed compare finds it.
+inline __m128i Sse2FlipCase(__m128i block, char first)
+{
+  const __m128i shifted = _mm_add_epi8(block, _mm_set1_epi8(static_cast<char>(128 - first)));
+  const __m128i letters = _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + 26)));
+  return _mm_xor_si128(block, _mm_and_si128(letters, _mm_set1_epi8(0x20)));
+}
+
+template <char FIRST>
+void Sse2FlipCaseRange(char* begin, char* end)
+{
+  char* p = begin;
+  for (; end - p >= 16; p += 16)
+  {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), Sse2FlipCase(block, FIRST));
+  }
+  for (; p < end; ++p)
+    *p = FlipCase(*p, FIRST);
+}
+
+void Sse2ToLower(char* begin, char* end)
+{
+  Sse2FlipCaseRange<'A'>(begin, end);
+}
+
+void Sse2ToUpper(char* begin, char* end)
+{
+  Sse2FlipCaseRange<'a'>(begin, end);
+}
+
+int Sse2CompareIgnoreCase(const char* a, const char* b, size_t size)
+{
+  size_t i = 0;
+  for (; size - i >= 16; i += 16)
+  {
+    const __m128i la = Sse2FlipCase(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), 'A');
+    const __m128i lb = Sse2FlipCase(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)), 'A');
+    const uint32_t differ = ~_mm_movemask_epi8(_mm_cmpeq_epi8(la, lb)) & 0xffff;
+    if (differ)
+      return ScalarCompareIgnoreCase(a + i + __builtin_ctz(differ), b + i + __builtin_ctz(differ), 1);
+  }
+  return ScalarCompareIgnoreCase(a + i, b + i, size - i);
+}
+
+// ------------------------------------------------------------------------------------------------------------
+// AVX2, only called after checking the CPU supports it
+
+__attribute__((target("avx2"))) size_t Avx2CountChar(const char* begin, const char* end, char c)
+{
+  const __m256i needle = _mm256_set1_epi8(c);
+  const char* p = begin;
+  size_t count = 0;
+  while (end - p >= 32)
+  {
+    __m256i counters = _mm256_setzero_si256();
+    for (int i = 0; i < 255 && end - p >= 32; ++i, p += 32)
+    {
+      const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(block, needle));
+    }
+
+    const __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+    count += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) + _mm256_extract_epi64(sums, 2) +
+             _mm256_extract_epi64(sums, 3);
+  }
+  return count + Sse2CountChar(p, end, c);
+}
+
+__attribute__((target("avx2"))) inline uint32_t Avx2NotInSet(const char* p, const __m256i* set, size_t setSize)
+{
+  const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  __m256i in = _mm256_setzero_si256();
+  for (size_t i = 0; i < setSize; ++i)
+    in = _mm256_or_si256(in, _mm256_cmpeq_epi8(block, set[i]));
+  return ~static_cast<uint32_t>(_mm256_movemask_epi8(in));
+}
+
+__attribute__((target("avx2"))) const char* Avx2FindFirstNotOf(const char* begin, const char* end,
+                                                               std::string_view set)
+{
+  if (set.size() > MAX_SIMD_SET)
+    return ScalarFindFirstNotOf(begin, end, set);
+
+  __m256i chars[MAX_SIMD_SET];
+  for (size_t i = 0; i < set.size(); ++i)
+    chars[i] = _mm256_set1_epi8(set[i]);
+
+  const char* p = begin;
+  for (; end - p >= 32; p += 32)
+  {
+    const uint32_t mask = Avx2NotInSet(p, chars, set.size());
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return Sse2FindFirstNotOf(p, end, set);
+}
+
+__attribute__((target("avx2"))) const char* Avx2FindLastNotOf(const char* begin, const char* end,
+                                                              std::string_view set)
+{
+  if (set.size() > MAX_SIMD_SET)
+    return ScalarFindLastNotOf(begin, end, set);
+
+  __m256i chars[MAX_SIMD_SET];
+  for (size_t i = 0; i < set.size(); ++i)
+    chars[i] = _mm256_set1_epi8(set[i]);
+
+  const char* p = end;
+  for (; p - begin >= 32; p -= 32)
+  {
+    const uint32_t mask = Avx2NotInSet(p - 32, chars, set.size());
+    if (mask)
+      return p - 32 + (32 - __builtin_clz(mask));
+  }
+  return Sse2FindLastNotOf(begin, p, set);
+}
+
+__attribute__((target("avx2"))) inline __m256i Avx2FlipCase(__m256i block, char first)
+{
+  const __m256i shifted = _mm256_add_epi8(block, _mm256_set1_epi8(static_cast<char>(128 - first)));
+  const __m256i letters = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+  return _mm256_xor_si256(block, _mm256_and_si256(letters, _mm256_set1_epi8(0x20)));
+}
+
+template <char FIRST>
+__attribute__((target("avx2"))) void Avx2FlipCaseRange(char* begin, char* end)
+{
+  char* p = begin;
+  for (; end - p >= 32; p += 32)
+  {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), Avx2FlipCase(block, FIRST));
+  }
+  Sse2FlipCaseRange<FIRST>(p, end);
+}
+
+__attribute__((target("avx2"))) void Avx2ToLower(char* begin, char* end)
+{
+  Avx2FlipCaseRange<'A'>(begin, end);
+}
+
+__attribute__((target("avx2"))) void Avx2ToUpper(char* begin, char* end)
+{
+  Avx2FlipCaseRange<'a'>(begin, end);
+}
+
+__attribute__((target("avx2"))) int Avx2CompareIgnoreCase(const char* a, const char* b, size_t size)
+{
+  size_t i = 0;
+  for (; size - i >= 32; i += 32)
+  {
+    const __m256i la = Avx2FlipCase(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), 'A');
+    const __m256i lb = Avx2FlipCase(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)), 'A');
+    const uint32_t differ = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(la, lb)));
+    if (differ)
+      return ScalarCompareIgnoreCase(a + i + __builtin_ctz(differ), b + i + __builtin_ctz(differ), 1);
+  }
+  return Sse2CompareIgnoreCase(a + i, b + i, size - i);
+}
+
+#endif
+
+const ScanKernels& Kernels()
+{
+  static const ScanKernels kernels = []() -> ScanKernels {
+#ifdef CPPHELPERS_SIMD_X86
+    if (__builtin_cpu_supports("avx2"))
+      return {"avx2", Avx2CountChar, Avx2FindFirstNotOf, Avx2FindLastNotOf, Avx2ToLower, Avx2ToUpper, Avx2CompareIgnoreCase};
+    return {"sse2", Sse2CountChar, Sse2FindFirstNotOf, Sse2FindLastNotOf, Sse2ToLower, Sse2ToUpper, Sse2CompareIgnoreCase};
+#else
+    return {"scalar", ScalarCountChar, ScalarFindFirstNotOf, ScalarFindLastNotOf, ScalarToLower, ScalarToUpper, ScalarCompareIgnoreCase};
+#endif
+  }();
+  return kernels;
+}
+
+}  // namespace
+
+const char* FindChar(const char* begin, const char* end, char c)
+{
+  // memchr is already vectorized (and dispatched per CPU) by the C library and beats
+  // a dedicated kernel on short tokens, where the dispatch overhead dominates
+  const void* hit = begin < end ? memchr(begin, c, end - begin) : nullptr;
+  return hit ? static_cast<const char*>(hit) : end;
+}
+
+size_t CountChar(const char* begin, const char* end, char c)
+{
+  return Kernels().countChar(begin, end, c);
+}
+
+const char* FindFirstNotOf(const char* begin, const char* end, std::string_view set)
+{
+  return Kernels().findFirstNotOf(begin, end, set);
+}
+
+const char* FindLastNotOf(const char* begin, const char* end, std::string_view set)
+{
+  return Kernels().findLastNotOf(begin, end, set);
+}
+
+void AsciiToLower(char* begin, char* end)
+{
+  Kernels().toLower(begin, end);
+}
+
+void AsciiToUpper(char* begin, char* end)
+{
+  Kernels().toUpper(begin, end);
+}
+
+int AsciiCompareIgnoreCase(const char* a, const char* b, size_t size)
+{
+  return Kernels().compareIgnoreCase(a, b, size);
+}
+
+const char* ScanKernelName()
+{
+  return Kernels().name;
+}
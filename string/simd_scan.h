@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <string_view>
+
+// Byte scanning kernels used by Split, Trim, case conversion and friends. On x86-64 they use
+// AVX2 when the CPU supports it (checked once at runtime) and SSE2 otherwise,
+// other architectures get a plain scalar version.
+
+// First c in [begin, end), or end. Uses memchr, which the C library already vectorizes.
+const char* FindChar(const char* begin, const char* end, char c);
+
+// Number of c in [begin, end), e.g. lines in a buffer
+size_t CountChar(const char* begin, const char* end, char c);
+
+// First char in [begin, end) that is not part of set, or end
+const char* FindFirstNotOf(const char* begin, const char* end, std::string_view set);
+
+// One past the last char in [begin, end) that is not part of set, or begin
+const char* FindLastNotOf(const char* begin, const char* end, std::string_view set);
+
+// ASCII only case conversion of [begin, end), other bytes are left untouched
+void AsciiToLower(char* begin, char* end);
+void AsciiToUpper(char* begin, char* end);
+
+// Compares size bytes of a and b as if both were lower case, returns <0, 0 or >0
+int AsciiCompareIgnoreCase(const char* a, const char* b, size_t size);
+
+// Name of the kernels picked for this CPU ("avx2", "sse2" or "scalar")
+const char* ScanKernelName();
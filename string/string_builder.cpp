@@ -0,0 +1,178 @@
+#include "string_builder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+// Blocks are powers of two between these sizes, larger ones bypass the cache
+constexpr size_t MIN_BLOCK_SHIFT = 9;
+constexpr size_t MAX_BLOCK_SHIFT = 20;
+// Free blocks kept per size and thread
+constexpr size_t BLOCKS_PER_SIZE = 4;
+
+class BlockCache
+{
+public:
+  ~BlockCache()
+  {
+    for (auto& blocks : mFree)
+    {
+      for (char* block : blocks)
+        delete[] block;
+    }
+    tAlive = false;
+  }
+
+  char* Acquire(size_t shift)
+  {
+    if (shift <= MAX_BLOCK_SHIFT)
+    {
+      auto& blocks = mFree[shift - MIN_BLOCK_SHIFT];
+      if (!blocks.empty())
+      {
+        char* block = blocks.back();
+        blocks.pop_back();
+        return block;
+      }
+    }
+    return new char[size_t(1) << shift];
+  }
+
+  void Release(char* block, size_t shift)
+  {
+    if (shift <= MAX_BLOCK_SHIFT)
+    {
+      auto& blocks = mFree[shift - MIN_BLOCK_SHIFT];
+      if (blocks.size() < BLOCKS_PER_SIZE)
+      {
+        blocks.push_back(block);
+        return;
+      }
+    }
+    delete[] block;
+  }
+
+  // Cleared once the cache of this thread is destroyed, builders outliving it free directly
+  static thread_local bool tAlive;
+
+private:
+  std::vector<char*> mFree[MAX_BLOCK_SHIFT - MIN_BLOCK_SHIFT + 1];
+};
+
+thread_local bool BlockCache::tAlive = true;
+thread_local BlockCache tCache;
+
+size_t BlockShift(size_t capacity)
+{
+  size_t shift = MIN_BLOCK_SHIFT;
+  while ((size_t(1) << shift) < capacity + 1)
+    ++shift;
+  return shift;
+}
+
+}  // namespace
+
+StringBuilder::StringBuilder(size_t capacity)
+{
+  Reserve(capacity);
+}
+
+StringBuilder::~StringBuilder()
+{
+  ReleaseBlock();
+}
+
+StringBuilder::StringBuilder(StringBuilder&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+StringBuilder& StringBuilder::operator=(StringBuilder&& other) noexcept
+{
+  if (this == &other)
+    return *this;
+
+  ReleaseBlock();
+  if (other.mData == other.mInline)
+  {
+    memcpy(mInline, other.mInline, other.mSize);
+    mData = mInline;
+    mCapacity = INLINE_CAPACITY - 1;
+  }
+  else
+  {
+    mData = other.mData;
+    mCapacity = other.mCapacity;
+  }
+  mSize = other.mSize;
+
+  other.mData = other.mInline;
+  other.mCapacity = INLINE_CAPACITY - 1;
+  other.mSize = 0;
+  return *this;
+}
+
+StringBuilder& StringBuilder::AppendHex(uint64_t value, bool prefix)
+{
+  if (prefix)
+    Append("0x");
+
+  Reserve(mSize + 16);
+  mSize = std::to_chars(mData + mSize, mData + mCapacity, value, 16).ptr - mData;
+  return *this;
+}
+
+StringBuilder& StringBuilder::AppendFormatArgs(const char* format, const FormatArg* args, size_t count)
+{
+  // Format into the free space, only grow and format again if it did not fit
+  const size_t len = FormatArgsTo(mData + mSize, mCapacity - mSize + 1, format, args, count);
+  if (len > mCapacity - mSize)
+  {
+    Reserve(mSize + len);
+    FormatArgsTo(mData + mSize, mCapacity - mSize + 1, format, args, count);
+  }
+  mSize += len;
+  return *this;
+}
+
+const char* StringBuilder::CStr()
+{
+  mData[mSize] = '\0';
+  return mData;
+}
+
+std::string StringBuilder::Release()
+{
+  std::string result(mData, mSize);
+  ReleaseBlock();
+  mData = mInline;
+  mCapacity = INLINE_CAPACITY - 1;
+  mSize = 0;
+  return result;
+}
+
+void StringBuilder::Grow(size_t capacity)
+{
+  // At least double, so appending n characters costs O(n) copies overall
+  const size_t shift = BlockShift(std::max(capacity, 2 * (mCapacity + 1)));
+  char* block = BlockCache::tAlive ? tCache.Acquire(shift) : new char[size_t(1) << shift];
+  memcpy(block, mData, mSize);
+
+  ReleaseBlock();
+  mData = block;
+  mCapacity = (size_t(1) << shift) - 1;
+}
+
+void StringBuilder::ReleaseBlock()
+{
+  if (mData == mInline)
+    return;
+
+  if (BlockCache::tAlive)
+    tCache.Release(mData, BlockShift(mCapacity));
+  else
+    delete[] mData;
+}
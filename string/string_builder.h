@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <charconv>
+#include <string>
+#include <string_view>
+
+#include "format.h"
+#include "numbers.h"
+
+// Accumulates text in an inline buffer, then in blocks that double in size. Blocks
+// come from and go back to a small per-thread cache, so a thread assembling similar
+// outputs over and over stops allocating after the first few.
+//   StringBuilder sb;
+//   sb.Append("File '").Append(path).Append("' has ").AppendNumber(size).Append(" bytes");
+//   std::string s = sb.Release();
+class StringBuilder
+{
+public:
+  static constexpr size_t INLINE_CAPACITY = 256;
+
+  StringBuilder() = default;
+  explicit StringBuilder(size_t capacity);
+  ~StringBuilder();
+
+  StringBuilder(StringBuilder&& other) noexcept;
+  StringBuilder& operator=(StringBuilder&& other) noexcept;
+
+  StringBuilder(const StringBuilder&) = delete;
+  StringBuilder& operator=(const StringBuilder&) = delete;
+
+  StringBuilder& Append(std::string_view str)
+  {
+    char* dst = Extend(str.size());
+    str.copy(dst, str.size());
+    return *this;
+  }
+
+  StringBuilder& Append(char c)
+  {
+    *Extend(1) = c;
+    return *this;
+  }
+
+  // Decimal for integers, shortest round-trip representation for floats
+  template <class T>
+  StringBuilder& AppendNumber(T value)
+  {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "AppendNumber needs a number");
+    Reserve(mSize + MaxNumberChars<T>());
+    mSize = std::to_chars(mData + mSize, mData + mCapacity, value).ptr - mData;
+    return *this;
+  }
+
+  StringBuilder& AppendHex(uint64_t value, bool prefix = true);
+
+  // printf style, see Format()
+  template <class... Args>
+  StringBuilder& AppendFormat(const char* format, const Args&... args)
+  {
+    const FormatArg packed[] = {FormatArg(args)..., FormatArg()};
+    return AppendFormatArgs(format, packed, sizeof...(Args));
+  }
+
+  StringBuilder& AppendFormatArgs(const char* format, const FormatArg* args, size_t count);
+
+  // Makes room for at least capacity characters in total
+  void Reserve(size_t capacity)
+  {
+    if (capacity > mCapacity)
+      Grow(capacity);
+  }
+
+  std::string_view View() const
+  {
+    return std::string_view(mData, mSize);
+  }
+
+  // 0 terminated content, valid until the next modification
+  const char* CStr();
+
+  size_t Size() const
+  {
+    return mSize;
+  }
+
+  bool IsEmpty() const
+  {
+    return mSize == 0;
+  }
+
+  // Empties the builder, keeping its storage
+  void Clear()
+  {
+    mSize = 0;
+  }
+
+  // Content as a std::string (a single exactly sized allocation), leaving the builder empty
+  std::string Release();
+
+private:
+  char* Extend(size_t size)
+  {
+    Reserve(mSize + size);
+    char* dst = mData + mSize;
+    mSize += size;
+    return dst;
+  }
+
+  void Grow(size_t capacity);
+  void ReleaseBlock();
+
+  char mInline[INLINE_CAPACITY];
+  char* mData = mInline;
+  // Usable size, the allocation has one more byte for the 0 terminator
+  size_t mCapacity = INLINE_CAPACITY - 1;
+  size_t mSize = 0;
+};
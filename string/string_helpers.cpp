@@ -1,130 +1,151 @@
 #include "string_helpers.h"
 
 #include <algorithm>
-#include <cstdarg>
 #include <cstring>
-#include <iterator>
-#include <sstream>
+
+#include "numbers.h"
 
 void ToUpperCase(std::string& str, uint32_t startPos)
 {
-  std::transform(str.begin() + startPos, str.end(), str.begin() + startPos, ::toupper);
+  ToUpperCaseInPlace(str, startPos, str.size());
 }
 
 void ToLowerCase(std::string& str, uint32_t startPos)
 {
-  std::transform(str.begin() + startPos, str.end(), str.begin() + startPos, ::tolower);
+  ToLowerCaseInPlace(str, startPos, str.size());
 }
 
 std::string ToUpperCase(const std::string& str, uint32_t startPos, uint32_t endPos)
 {
   std::string cpy = str;
-  std::transform(cpy.begin() + startPos, cpy.begin() + endPos, cpy.begin() + startPos, ::toupper);
+  ToUpperCaseInPlace(cpy, startPos, endPos);
   return cpy;
 }
 
 std::string ToLowerCase(const std::string& str, uint32_t startPos, uint32_t endPos)
 {
   std::string cpy = str;
-  std::transform(cpy.begin() + startPos, cpy.begin() + endPos, cpy.begin() + startPos, ::tolower);
+  ToLowerCaseInPlace(cpy, startPos, endPos);
   return cpy;
 }
 
-std::string Format(const std::string& str, ...)
+void ToUpperCaseInPlace(std::string& str, uint32_t startPos, uint32_t endPos)
 {
-  return Format(str.c_str());
+  const size_t end = std::min<size_t>(endPos, str.size());
+  if (startPos < end)
+    AsciiToUpper(&str[startPos], &str[0] + end);
 }
 
-std::string Format(const char* format, ...)
+void ToLowerCaseInPlace(std::string& str, uint32_t startPos, uint32_t endPos)
 {
-  va_list valist;
-
-  int len = 0;
-  va_start(valist, format);
-#ifdef _MSC_VER
-  // _vscprintf computes the length WITHOUT writing to a buffer
-  len = _vscprintf(format, valist);
-  va_end(valist);
-
-  if (len < 0)
-    return {};
-
-  // +1 for the null terminator
-  std::vector<char> buffer(static_cast<size_t>(len) + 1);
-
-  va_start(valist, format);
-  // vsnprintf_s is the "safe" MSVC version
-  int written = vsnprintf_s(buffer.data(), buffer.size(), _TRUNCATE, format, valist);
-  va_end(valist);
-
-  if (written < 0)
-    return {};
+  const size_t end = std::min<size_t>(endPos, str.size());
+  if (startPos < end)
+    AsciiToLower(&str[startPos], &str[0] + end);
+}
 
-  // Construct string without the trailing '\0'
-  return std::string(buffer.data(), static_cast<size_t>(written));
-#else
-  len = vsnprintf(0, 0, format, valist);
-  va_end(valist);
+bool EqualsIgnoreCase(std::string_view a, std::string_view b)
+{
+  return a.size() == b.size() && AsciiCompareIgnoreCase(a.data(), b.data(), a.size()) == 0;
+}
 
-  if (len < 0)
-    return {};
+int CompareIgnoreCase(std::string_view a, std::string_view b)
+{
+  if (int result = AsciiCompareIgnoreCase(a.data(), b.data(), std::min(a.size(), b.size())))
+    return result;
 
-  // Allocate buffer including space for 0 termination
-  char buffer[len + 1];
+  return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
 
-  va_start(valist, format);
-  std::vsnprintf(buffer, (uint32_t)(len + 1), format, valist);
-  va_end(valist);
+size_t HashIgnoreCase(std::string_view str)
+{
+  auto mix = [](uint64_t h) {
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 31);
+  };
+
+  // Lower case a chunk at a time on the stack, then hash it 8 bytes at a time
+  uint64_t hash = 0x9e3779b97f4a7c15ULL ^ str.size();
+  char chunk[64];
+  for (size_t pos = 0; pos < str.size(); pos += sizeof(chunk))
+  {
+    const size_t len = std::min(sizeof(chunk), str.size() - pos);
+    memcpy(chunk, str.data() + pos, len);
+    AsciiToLower(chunk, chunk + len);
+
+    for (size_t i = 0; i < len; i += sizeof(uint64_t))
+    {
+      uint64_t word = 0;
+      memcpy(&word, chunk + i, std::min(sizeof(uint64_t), len - i));
+      hash = mix(hash ^ word);
+    }
+  }
 
-  return std::string(buffer);
-#endif
+  return mix(hash ^ (hash >> 29));
 }
 
 std::string LTrim(std::string s, const char* t)
 {
-  s.erase(0, s.find_first_not_of(t));
+  s.erase(0, FindFirstNotOf(s.data(), s.data() + s.size(), t) - s.data());
   return s;
 }
 
 std::string RTrim(std::string s, const char* t)
 {
-  s.erase(s.find_last_not_of(t) + 1);
+  s.erase(FindLastNotOf(s.data(), s.data() + s.size(), t) - s.data());
   return s;
 }
 
 std::string Trim(std::string s, const char* t)
 {
-  return LTrim(RTrim(s, t), t);
+  return LTrim(RTrim(std::move(s), t), t);
+}
+
+SplitRange SplitView(std::string_view str, char c)
+{
+  return SplitRange(str, c);
 }
 
 std::vector<std::string> Split(const std::string& str, char c)
 {
   std::vector<std::string> splitList;
-  size_t prev = 0;
-  for (size_t idx = str.find(c); idx != std::string::npos; idx = str.find(c, idx + 1))
-  {
-    splitList.push_back(str.substr(prev, idx - prev));
-    prev = idx + 1;
-  }
-  std::string remainder = str.substr(prev);
-  if (!remainder.empty())
-  {
-    splitList.push_back(remainder);
-  }
+  splitList.reserve(CountChar(str.data(), str.data() + str.size(), c) + 1);
+  for (std::string_view token : SplitView(str, c))
+    splitList.emplace_back(token);
 
   return splitList;
 }
 
+void Split(std::string_view str, char c, std::vector<std::string_view>& out)
+{
+  out.clear();
+  for (std::string_view token : SplitView(str, c))
+    out.push_back(token);
+}
+
+bool SplitPair(std::string_view pair, char c, std::string_view& key, std::string_view& value)
+{
+  SplitRange tokens = SplitView(pair, c);
+  auto it = tokens.begin();
+  if (it == tokens.end())
+    return false;
+
+  key = *it++;
+  if (it == tokens.end())
+    return false;
+
+  value = *it++;
+  return it == tokens.end();
+}
+
 std::map<std::string, std::string> Split(const std::string& str, char c1, char c2)
 {
   std::map<std::string, std::string> m;
 
-  std::vector<std::string> v = Split(str, c1);
-  for (const std::string& pairs : v)
+  std::string_view key, value;
+  for (std::string_view pair : SplitView(str, c1))
   {
-    auto vInner = Split(pairs, c2);
-    if (vInner.size() == 2)
-      m[vInner[0]] = vInner[1];
+    if (SplitPair(pair, c2, key, value))
+      m[std::string(key)] = std::string(value);
   }
 
   return m;
@@ -142,23 +163,12 @@ std::vector<std::string> Keys(const std::map<std::string, uint32_t>& v)
 
 std::string HexToString(uint32_t hex)
 {
-  std::stringstream ss;
-  ss << "0x" << std::hex << hex;
-  return ss.str();
+  std::string out;
+  AppendHex(out, hex);
+  return out;
 }
 
 std::string VectorToString(const std::vector<uint32_t>& values)
 {
-  if (values.empty())
-    return std::string();
-
-  std::ostringstream toReturn;
-
-  // Convert all but the last element to avoid a trailing ","
-  std::copy(values.begin(), values.end() - 1, std::ostream_iterator<uint32_t>(toReturn, ", "));
-
-  // Add the last element with no delimiter
-  toReturn << values.back();
-
-  return toReturn.str();
+  return Join(values, ", ");
 }
@@ -2,10 +2,16 @@
 
 #include <stdint.h>
 
+#include <cstddef>
+#include <iterator>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "format.h"
+#include "simd_scan.h"
+
 #define WHITESPACE_CHARS " \t\n\r\f\v"
 
 void ToUpperCase(std::string& str, uint32_t startPos = 0);
@@ -14,15 +20,166 @@ void ToLowerCase(std::string& str, uint32_t startPos = 0);
 std::string ToUpperCase(const std::string& str, uint32_t startPos, uint32_t endPos);
 std::string ToLowerCase(const std::string& str, uint32_t startPos, uint32_t endPos);
 
-std::string Format(const std::string& str, ...);
-std::string Format(const char* format, ...);
+// Converts [startPos, endPos) of str without copying it, endPos is clamped to the size
+void ToUpperCaseInPlace(std::string& str, uint32_t startPos, uint32_t endPos);
+void ToLowerCaseInPlace(std::string& str, uint32_t startPos, uint32_t endPos);
+
+// ASCII case-insensitive comparison and hashing, e.g. for header names
+bool EqualsIgnoreCase(std::string_view a, std::string_view b);
+int CompareIgnoreCase(std::string_view a, std::string_view b);
+size_t HashIgnoreCase(std::string_view str);
+
+// std::unordered_map<std::string, T, IgnoreCaseHash, IgnoreCaseEqual>
+struct IgnoreCaseHash
+{
+  size_t operator()(std::string_view str) const
+  {
+    return HashIgnoreCase(str);
+  }
+};
+
+struct IgnoreCaseEqual
+{
+  bool operator()(std::string_view a, std::string_view b) const
+  {
+    return EqualsIgnoreCase(a, b);
+  }
+};
+
+// printf style formatting, see format.h. Use FORMAT() to check the format string at compile time.
+template <class... Args>
+std::string Format(const char* format, const Args&... args)
+{
+  const FormatArg packed[] = {FormatArg(args)..., FormatArg()};
+  return FormatArgs(format, packed, sizeof...(Args));
+}
+
+template <class... Args>
+std::string Format(const std::string& format, const Args&... args)
+{
+  return Format(format.c_str(), args...);
+}
 
 std::string Trim(std::string s, const char* t = WHITESPACE_CHARS);
 std::string LTrim(std::string s, const char* t = WHITESPACE_CHARS);
 std::string RTrim(std::string s, const char* t = WHITESPACE_CHARS);
 
+// Lazy range over the tokens of a string, yielding views into it without allocating.
+// Same tokens as Split(): empty tokens between delimiters are kept, a trailing empty one is not.
+class SplitRange
+{
+public:
+  class Iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view*;
+    using reference = const std::string_view&;
+
+    // End iterator
+    Iterator() = default;
+
+    Iterator(std::string_view str, char c)
+        : mRest(str)
+        , mDelimiter(c)
+        , mDone(false)
+    {
+      Advance();
+    }
+
+    reference operator*() const
+    {
+      return mToken;
+    }
+
+    pointer operator->() const
+    {
+      return &mToken;
+    }
+
+    Iterator& operator++()
+    {
+      Advance();
+      return *this;
+    }
+
+    Iterator operator++(int)
+    {
+      Iterator previous = *this;
+      Advance();
+      return previous;
+    }
+
+    bool operator==(const Iterator& other) const
+    {
+      return mDone == other.mDone && (mDone || mToken.data() == other.mToken.data());
+    }
+
+    bool operator!=(const Iterator& other) const
+    {
+      return !(*this == other);
+    }
+
+  private:
+    void Advance()
+    {
+      if (mRest.empty())
+      {
+        mDone = true;
+        return;
+      }
+
+      const char* end = mRest.data() + mRest.size();
+      const char* hit = FindChar(mRest.data(), end, mDelimiter);
+      mToken = std::string_view(mRest.data(), hit - mRest.data());
+      mRest = hit == end ? std::string_view() : std::string_view(hit + 1, end - hit - 1);
+    }
+
+    std::string_view mRest;
+    std::string_view mToken;
+    char mDelimiter = 0;
+    bool mDone = true;
+  };
+
+  SplitRange(std::string_view str, char c)
+      : mStr(str)
+      , mDelimiter(c)
+  {
+  }
+
+  Iterator begin() const
+  {
+    return Iterator(mStr, mDelimiter);
+  }
+
+  Iterator end() const
+  {
+    return Iterator();
+  }
+
+private:
+  std::string_view mStr;
+  char mDelimiter;
+};
+
+// for (std::string_view token : SplitView(payload, ';'))
+// The tokens point into str, which must outlive them.
+SplitRange SplitView(std::string_view str, char c);
+SplitRange SplitView(std::string&& str, char c) = delete;
+
 std::vector<std::string> Split(const std::string& str, char c);
+// Fills out (cleared first) with views into str, reusing its capacity across calls
+void Split(std::string_view str, char c, std::vector<std::string_view>& out);
 std::vector<std::string> Keys(const std::map<std::string, uint32_t>& v);
+// "k1=v1;k2=v2" into a map, only pairs that split into exactly two tokens are kept.
+// See KeyValueView (key_value_view.h) for a version that does not copy.
 std::map<std::string, std::string> Split(const std::string& str, char c1, char c2);
+// Splits pair into exactly two tokens around c, using the same rules as the map version
+bool SplitPair(std::string_view pair, char c, std::string_view& key, std::string_view& value);
 
+// "0x1f"
+std::string HexToString(uint32_t hex);
+// "1, 2, 3", see Join() in numbers.h for other types and separators
 std::string VectorToString(const std::vector<uint32_t>& values);
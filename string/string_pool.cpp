@@ -0,0 +1,77 @@
+#include "string_pool.h"
+
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+StringPool& StringPool::Global()
+{
+  static StringPool* pool = new StringPool();
+  return *pool;
+}
+
+std::string_view StringPool::Intern(std::string_view str)
+{
+  Shard& shard = mShards[std::hash<std::string_view>()(str) % SHARD_COUNT];
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.strings.find(str);
+    if (it != shard.strings.end())
+      return *it;
+  }
+
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  auto it = shard.strings.find(str);
+  if (it != shard.strings.end())
+    return *it;
+
+  // Small strings are packed into shared blocks, large ones get their own
+  const size_t size = str.size() + 1;
+  char* dst;
+  if (size > BLOCK_SIZE / 4)
+  {
+    shard.blocks.emplace(shard.blocks.begin(), new char[size]);
+    dst = shard.blocks.front().get();
+    shard.memory += size;
+  }
+  else
+  {
+    if (shard.blockFree < size)
+    {
+      shard.blocks.emplace_back(new char[BLOCK_SIZE]);
+      shard.blockFree = BLOCK_SIZE;
+      shard.memory += BLOCK_SIZE;
+    }
+    dst = shard.blocks.back().get() + BLOCK_SIZE - shard.blockFree;
+    shard.blockFree -= size;
+  }
+
+  memcpy(dst, str.data(), str.size());
+  dst[str.size()] = '\0';
+
+  std::string_view interned(dst, str.size());
+  shard.strings.insert(interned);
+  return interned;
+}
+
+size_t StringPool::Size() const
+{
+  size_t size = 0;
+  for (const Shard& shard : mShards)
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    size += shard.strings.size();
+  }
+  return size;
+}
+
+size_t StringPool::MemoryUsage() const
+{
+  size_t memory = 0;
+  for (const Shard& shard : mShards)
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    memory += shard.memory;
+  }
+  return memory;
+}
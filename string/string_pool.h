@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Keeps a single copy of every string handed to Intern(). The returned views stay
+// valid for the lifetime of the pool and are 0 terminated, and equal strings give
+// the same view so they can be compared by pointer. Nothing is ever removed, so it
+// is meant for bounded sets such as file names, keys or header names.
+// Thread safe, lookups of already interned strings only take a shared lock.
+class StringPool
+{
+public:
+  StringPool() = default;
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  // Process wide pool, never destroyed so its views remain valid during static destruction
+  static StringPool& Global();
+
+  std::string_view Intern(std::string_view str);
+
+  // Number of distinct strings
+  size_t Size() const;
+  // Bytes allocated for the string data
+  size_t MemoryUsage() const;
+
+private:
+  static constexpr size_t SHARD_COUNT = 16;
+  static constexpr size_t BLOCK_SIZE = 4096;
+
+  struct Shard
+  {
+    mutable std::shared_mutex mutex;
+    std::unordered_set<std::string_view> strings;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    // Free space left in blocks.back()
+    size_t blockFree = 0;
+    size_t memory = 0;
+  };
+
+  Shard mShards[SHARD_COUNT];
+};
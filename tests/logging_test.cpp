@@ -0,0 +1,132 @@
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logging.h"
+#include "sinks.h"
+
+namespace
+{
+
+int gFailures = 0;
+
+#define CHECK(condition)                                                            \
+  do                                                                                \
+  {                                                                                 \
+    if (!(condition))                                                               \
+    {                                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      ++gFailures;                                                                  \
+    }                                                                               \
+  } while (0)
+
+// Logging from a static constructor, which may run before logging.cpp is initialized
+struct StaticLogger
+{
+  StaticLogger()
+  {
+    LOG_INFO("Logged from a static constructor %d", 1);
+    levelPrefix = logging::LevelPrefix(logging::LogLevel::Info, false);
+  }
+
+  std::string levelPrefix;
+};
+StaticLogger gStaticLogger;
+
+bool EndsWith(const std::string& line, const std::string& suffix)
+{
+  return line.size() >= suffix.size() && line.compare(line.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Formats starting with a literal but built at runtime are rendered, not kept by pointer
+void TestConcatenatedFormat(bool async)
+{
+  auto sink = std::make_shared<logging::MemorySink>(16);
+  const logging::SinkId id = logging::AddSink(sink);
+  if (async)
+    logging::EnableAsync();
+
+  {
+    std::string str = "My String";
+    LOG_INFO("Original string: " + str);
+    const char format[] = "Local array %d";
+    LOG_INFO(format, 42);
+  }
+  logging::Flush();
+
+  if (async)
+    logging::DisableAsync();
+  logging::RemoveSink(id);
+
+  const std::vector<std::string> lines = sink->Lines();
+  CHECK(lines.size() == 2);
+  if (lines.size() == 2)
+  {
+    CHECK(EndsWith(lines[0], "Original string: My String\n"));
+    CHECK(EndsWith(lines[1], "Local array 42\n"));
+  }
+}
+
+constexpr int FLUSH_THREADS = 4;
+constexpr int FLUSH_RECORDS = 2000;
+
+// Counts the records of each thread, the message is the thread index
+class CountingSink : public logging::Sink
+{
+public:
+  void Write(const logging::LogRecord& record) override
+  {
+    const int thread = std::stoi(record.message);
+    if (thread >= 0 && thread < FLUSH_THREADS)
+      counts[thread].fetch_add(1);
+  }
+
+  std::atomic<int> counts[FLUSH_THREADS] = {};
+};
+
+// Everything a thread logged before its Flush() is written once Flush() returns, even
+// while other threads keep the writer busy
+void TestAsyncFlush()
+{
+  auto sink = std::make_shared<CountingSink>();
+  const logging::SinkId id = logging::AddSink(sink);
+  logging::EnableAsync(64, logging::OverflowPolicy::Block);
+
+  std::atomic<int> incomplete = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < FLUSH_THREADS; ++t)
+  {
+    threads.emplace_back([t, &sink, &incomplete]() {
+      for (int i = 0; i < FLUSH_RECORDS; ++i)
+        LOG_INFO("%d", t);
+      logging::Flush();
+      if (sink->counts[t].load() != FLUSH_RECORDS)
+        incomplete.fetch_add(1);
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  logging::DisableAsync();
+  logging::RemoveSink(id);
+  CHECK(incomplete.load() == 0);
+}
+
+}  // namespace
+
+int main()
+{
+  logging::RemoveSink(logging::CONSOLE_SINK);
+
+  CHECK(gStaticLogger.levelPrefix == "I");
+  TestConcatenatedFormat(false);
+  TestConcatenatedFormat(true);
+  TestAsyncFlush();
+
+  if (gFailures)
+    fprintf(stderr, "%d checks failed\n", gFailures);
+  return gFailures ? 1 : 0;
+}